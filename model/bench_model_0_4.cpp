@@ -0,0 +1,207 @@
+// model_0_4 性能基准：微基准 + 端到端，结果以 JSON 输出，便于在不同版本之间对比
+// 编译：g++ -O2 -std=c++17 -pthread bench_model_0_4.cpp -o bench_model_0_4
+// 运行：./bench_model_0_4 [模型参数，如 --exact --simd=auto --threads=0] [--synthetic-matches=N] [--input=逐分数据] [--out=文件]
+#include <iomanip>
+
+#include "model_0_4_drivers.hpp"
+
+volatile double bench_sink;  // 防止被测调用被优化掉
+
+struct MicroResult {
+    std::string name;
+    long long iterations;
+    double ns_per_op;
+};
+
+struct EndToEndResult {
+    std::string name;
+    int matches;
+    long long points;
+    long long rollouts;
+    double seconds;
+};
+
+double seconds_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// 反复调用 op，直到累计时间超过 min_seconds
+template <class F>
+MicroResult micro(const std::string& name, F op, double min_seconds = 0.2) {
+    long long iterations = 0, batch = 1;
+    auto t0 = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    while (elapsed < min_seconds) {
+        for (long long i = 0; i < batch; i++) op(iterations + i);
+        iterations += batch;
+        batch *= 2;
+        elapsed = seconds_since(t0);
+    }
+    return {name, iterations, elapsed * 1e9 / iterations};
+}
+
+// 合成比赛：每分双方各 50% 得分，七局四胜，由随机数种子和比赛编号确定
+MatchRecord synthetic_match(uint32_t match) {
+    PhiloxStream rng(rng_seed, match, 0xffffffffu, 0);
+    std::vector<std::string> games;
+    int won_a = 0, won_b = 0;
+    while (won_a < 4 && won_b < 4) {
+        std::string seq;
+        int a = 0, b = 0;
+        while (!isGameOver(a, b)) {
+            if (rng() & 1) seq += playerA.id, a++;
+            else seq += playerB.id, b++;
+        }
+        (isGameOver(a, b) == 1 ? won_a : won_b)++;
+        games.push_back(seq);
+    }
+    return matchFromGames(games);
+}
+
+// --batch 时按 num_threads 个线程批量分析，否则单线程逐场分析
+EndToEndResult end_to_end(const std::string& name, const std::vector<MatchRecord>& matches) {
+    long long rollouts_before = rollout_count;
+    BatchStats stats = analyseBatch(matches, batch_mode ? num_threads : 1, nullptr);
+    return {name, stats.matches, stats.points, rollout_count - rollouts_before, stats.seconds};
+}
+
+// calc_leverage 的求解方式：--crn 在蒙特卡洛下绕过 winningRate，其余与 winningRate 的分派相同
+const char* solver_name() {
+    if (use_crn && solver_mode == SolverMode::MonteCarlo) return "crn";
+    return winRateSolverName(winRateSolver());
+}
+
+// 每秒的速率；耗时为 0（如空输入）时记 0，保证输出是合法的 JSON
+double per_second(double x, double seconds) {
+    return seconds > 0 ? x / seconds : 0.0;
+}
+
+const char* simd_name() {
+    switch (simd_level) {
+        case SimdLevel::AVX512: return "avx512";
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::Generic: return "generic";
+        default: return "off";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    parseArgs(argc, argv);
+    int synthetic_matches = 20;
+    std::string out_path;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--synthetic-matches=", 0) == 0) synthetic_matches = std::stoi(arg.substr(20));
+        else if (arg.rfind("--out=", 0) == 0) out_path = arg.substr(6);
+    }
+
+    std::vector<MicroResult> micros;
+    micros.push_back(micro("isGameOver", [](long long i) {
+        bench_sink = isGameOver(i % 15, (i / 15) % 15);
+    }));
+    micros.push_back(micro("calculateEloRating", [](long long i) {
+        bench_sink = calculateEloRating(playerA, 0.01 * (i % 7), 0.01 * (i % 5));
+    }));
+    std::vector<PointInfo> points;
+    for (int k = 0; k < 2 * WINDOW_SIZE; k++) points.emplace_back(0.05 * (k % 2), -0.05 * (k % 3 == 0), 0.0, 0.0, k / WINDOW_SIZE);
+    micros.push_back(micro("calc_momentum", [&](long long i) {
+        auto [M1, M2] = calc_momentum(points, 1 + (i & 1));
+        bench_sink = M1 + M2;
+    }));
+    MomentumWindow window;
+    micros.push_back(micro("MomentumWindow::push", [&](long long i) {
+        window.push(0.05 * (i & 1), -0.05 * ((i >> 1) & 1), 0);
+        window.update_momentum(0);
+        bench_sink = window.M_A;
+    }));
+
+    // winningRate / calc_leverage 在第 2 局中段的真实历史上测量，比分逐次变化；
+    // 每次先 touch() 让 --exact 的记忆表失效、清空 --cache，每次都是一次完整求解
+    std::vector<std::string> seqs = get_game_score_seqs();
+    MatchContext ctx;
+    analyseMatch(ctx, matchFromGames({seqs[0], seqs[1].substr(0, 8)}), nullptr);
+    auto cold = [&] {
+        ctx.touch();
+        if (use_cache) win_rate_cache.clear();
+    };
+    micros.push_back(micro("winningRate", [&](long long i) {
+        cold();
+        bench_sink = std::get<0>(winningRate(ctx, 3 + i % 3, 4 + i / 3 % 3, 1));
+    }, 1.0));
+    micros.push_back(micro("calc_leverage", [&](long long i) {
+        cold();
+        bench_sink = calc_leverage(ctx, 3 + i % 3, 4 + i / 3 % 3, 1);
+    }, 1.0));
+
+    // 改正第 3 局中的一分（来回切换），只重算受影响的后续分
+    IncrementalMatch amended(matchFromGames(seqs), 0);
+    micros.push_back(micro("IncrementalMatch::amend", [&](long long i) {
+        bench_sink = amended.amend(40, i & 1 ? playerA.id : playerB.id);
+    }, 1.0));
+
+    // 文本表格格式化（写入丢弃数据的流，只计格式化和缓冲）
+    struct NullBuf : std::streambuf {
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+    } null_buf;
+    std::ostream null_out(&null_buf);
+    MatchResult table;
+    analyseMatch(ctx, matchFromGames(seqs), &table);
+    {
+        TableWriter writer(null_out);
+        micros.push_back(micro("TableWriter::row", [&](long long i) {
+            printRow(writer, table, i % table.size());
+        }));
+    }
+
+    std::vector<EndToEndResult> e2e;
+    e2e.push_back(end_to_end("reference_7_games", {matchFromGames(seqs)}));
+    std::vector<MatchRecord> synthetic;
+    for (int m = 0; m < synthetic_matches; m++) synthetic.push_back(synthetic_match(m));
+    e2e.push_back(end_to_end("synthetic_best_of_7", synthetic));
+    if (!input_path.empty() && input_path != "-") {
+        // 只计读入和切分，不做分析
+        std::ifstream file(input_path, std::ios::binary);
+        MatchReader reader(file);
+        long long points = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        int matches = reader.readAll([&](const MatchRecord& match) { points += match.points.size(); });
+        e2e.push_back({"ingest_input", matches, points, 0, seconds_since(t0)});
+    }
+
+    std::ofstream file;
+    if (!out_path.empty()) file.open(out_path);
+    std::ostream& out = out_path.empty() ? std::cout : file;
+    out << std::setprecision(6);
+    out << "{\n";
+    out << "  \"model\": \"model_0_4\",\n";
+    out << "  \"config\": {\"solver\": \"" << solver_name() << "\", \"simd\": \"" << simd_name()
+        << "\", \"threads\": " << num_threads
+        << ", \"batch\": " << (batch_mode ? "true" : "false") << ", \"cache\": " << (use_cache ? "true" : "false")
+        << ", \"antithetic\": " << (use_antithetic ? "true" : "false")
+        << ", \"control_variate\": " << (use_control_variate ? "true" : "false")
+        << ", \"qmc\": " << (use_qmc ? "true" : "false")
+        << ", \"importance\": " << (use_importance ? "true" : "false")
+        << ", \"speculative\": " << spec_width
+        << ", \"budget\": " << rollout_budget
+        << ", \"seed\": " << rng_seed << "},\n";
+    out << "  \"micro\": [\n";
+    for (size_t i = 0; i < micros.size(); i++) {
+        const MicroResult& r = micros[i];
+        out << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+            << ", \"ns_per_op\": " << r.ns_per_op << "}" << (i + 1 < micros.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"end_to_end\": [\n";
+    for (size_t i = 0; i < e2e.size(); i++) {
+        const EndToEndResult& r = e2e[i];
+        out << "    {\"name\": \"" << r.name << "\", \"matches\": " << r.matches << ", \"points\": " << r.points
+            << ", \"rollouts\": " << r.rollouts << ", \"seconds\": " << r.seconds
+            << ", \"matches_per_sec\": " << per_second(r.matches, r.seconds)
+            << ", \"points_per_sec\": " << per_second(r.points, r.seconds)
+            << ", \"rollouts_per_sec\": " << per_second(r.rollouts, r.seconds) << "}" << (i + 1 < e2e.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+    return 0;
+}
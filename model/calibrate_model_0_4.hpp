@@ -0,0 +1,587 @@
+// model_0_4 的运行期参数模型、校准目标和无导数搜索（calibrate_model_0_4 和 sensitivity_model_0_4 共用）
+#pragma once
+
+#include <iomanip>
+#include <map>
+#include <set>
+
+#include "model_0_4_options.hpp"
+
+/******************************parameters*************************************/
+
+constexpr int MAX_WINDOW = 7;  // 校准时窗口长度的上限（动态规划的状态数随窗口指数增长）
+
+// 连续参数，搜索时按上下界映射到 [0, 1]
+enum ParamIndex { P_ALPHA, P_BETA, P_W_CAP, P_W_M, P_W_DELTA_M, P_CAP_A, P_CAP_B, P_PSY_A, P_PSY_B, P_STA_A, P_STA_B, N_PARAMS };
+
+struct ParamSpec {
+    const char* name;
+    double lo, hi;
+};
+const ParamSpec PARAM_SPECS[N_PARAMS] = {
+    {"alpha", 0.01, 0.99}, {"beta", 0.01, 0.99},
+    {"w_cap", 0.0, 2.0}, {"w_M", 0.0, 2.0}, {"w_delta_M", 0.0, 2.0},
+    {"cap_A", 0.0, 1.5}, {"cap_B", 0.0, 1.5},
+    {"psy_A", 0.0, 1.0}, {"psy_B", 0.0, 1.0},
+    {"sta_A", 0.1, 2.0}, {"sta_B", 0.1, 2.0},
+};
+
+struct Params {
+    std::array<double, N_PARAMS> x;
+    int window;
+};
+
+using Unit = std::array<double, N_PARAMS>;
+
+// 当前模型里的取值
+inline Params modelParams() {
+    Params p;
+    p.x = {Core::Decay::alpha, Core::Decay::beta, Core::Elo::w_cap, Core::Elo::w_M, Core::Elo::w_delta_M,
+           playerA.cap, playerB.cap, playerA.psy, playerB.psy, playerA.sta, playerB.sta};
+    p.window = Core::WINDOW_SIZE;
+    return p;
+}
+
+inline Unit toUnit(const Params& p) {
+    Unit u;
+    for (int i = 0; i < N_PARAMS; i++) u[i] = (p.x[i] - PARAM_SPECS[i].lo) / (PARAM_SPECS[i].hi - PARAM_SPECS[i].lo);
+    return u;
+}
+
+// 超出 [0, 1] 的坐标截断到边界
+inline Params fromUnit(const Unit& u, int window) {
+    Params p;
+    for (int i = 0; i < N_PARAMS; i++) {
+        double t = std::min(1.0, std::max(0.0, u[i]));
+        p.x[i] = PARAM_SPECS[i].lo + t * (PARAM_SPECS[i].hi - PARAM_SPECS[i].lo);
+    }
+    p.window = window;
+    return p;
+}
+
+/******************************parameters*************************************/
+
+/******************************tuned model************************************/
+
+// 运行期参数的模型：公式与 Core 相同，衰减表和 elo 的线性系数在构造时算好。
+// 标量类型 T 为 double 时用于校准；sensitivity_model_0_4 用对偶数实例化，同一套公式顺带求出对参数的导数
+template <class T>
+struct BasicTunedModel {
+    int window;
+    T same[MAX_WINDOW + 1], cross[MAX_WINDOW + 1];
+    T a0, a_m, a_d, b0, b_m, b_d;  // elo 线性部分，与 lockstep 内核相同的拆法
+
+    explicit BasicTunedModel(const Params& p) : BasicTunedModel(toScalars(p.x), p.window) {}
+
+    BasicTunedModel(const std::array<T, N_PARAMS>& x, int window) : window(window) {
+        same[0] = cross[0] = 1.0;
+        for (int d = 1; d <= MAX_WINDOW; d++) {
+            same[d] = same[d - 1] * (1 - x[P_ALPHA]);
+            cross[d] = cross[d - 1] * (1 - x[P_BETA]);
+        }
+        a0 = x[P_CAP_A] * x[P_W_CAP] * x[P_STA_A], a_m = x[P_W_M] * x[P_STA_A];
+        a_d = x[P_W_DELTA_M] * (1 - x[P_PSY_A]) * x[P_STA_A];
+        b0 = x[P_CAP_B] * x[P_W_CAP] * x[P_STA_B], b_m = x[P_W_M] * x[P_STA_B];
+        b_d = x[P_W_DELTA_M] * (1 - x[P_PSY_B]) * x[P_STA_B];
+    }
+
+    static std::array<T, N_PARAMS> toScalars(const std::array<double, N_PARAMS>& x) {
+        std::array<T, N_PARAMS> r;
+        for (int i = 0; i < N_PARAMS; i++) r[i] = x[i];
+        return r;
+    }
+
+    static T squash(const T& x) {
+        using std::exp;
+        return 1.0 / (1.0 + exp(-x));
+    }
+    T eloA(const T& M_self, const T& delta_M) const { return squash(a0 + a_m * M_self - a_d * delta_M); }
+    T eloB(const T& M_self, const T& delta_M) const { return squash(b0 + b_m * M_self - b_d * delta_M); }
+
+    // 一场比赛的损失实际读到的全部量：elo 的 6 个有效系数和窗口内用到的衰减权重 same[1..window-1]、
+    // cross[1..window-1]（距离 0 的权重恒为 1）。真实历史的窗口不分局，中间隔着空局也会读到更早一局的分，
+    // 所以比赛只有一局有分时跨局权重才读不到，cross_game 为假时不计入。
+    // 相同即这场比赛的结果相同（仅 double）
+    using Key = std::array<int64_t, 7 + 2 * (MAX_WINDOW - 1)>;
+    Key key(bool cross_game) const {
+        auto q = [](double x) { return (int64_t)std::llround(x * 1e12); };
+        Key k{window, q(a0), q(a_m), q(a_d), q(b0), q(b_m), q(b_d)};
+        for (int d = 1; d < window; d++) {
+            k[6 + d] = q(same[d]);
+            if (cross_game) k[6 + MAX_WINDOW - 1 + d] = q(cross[d]);
+        }
+        return k;
+    }
+};
+
+// 与 MomentumWindow 同义的定长窗口，长度在运行期给定；按从旧到新存放，直接求加权和
+template <class T>
+struct BasicTunedWindow {
+    T G_A[MAX_WINDOW], G_B[MAX_WINDOW];
+    int game[MAX_WINDOW];
+    int count = 0;
+    T M_A = 0.0, M_B = 0.0;
+
+    void push(const BasicTunedModel<T>& m, const T& ga, const T& gb, int game_idx) {
+        if (count == m.window) {
+            for (int k = 1; k < count; k++) G_A[k - 1] = G_A[k], G_B[k - 1] = G_B[k], game[k - 1] = game[k];
+            count--;
+        }
+        G_A[count] = ga, G_B[count] = gb, game[count] = game_idx;
+        count++;
+    }
+
+    void update_momentum(const BasicTunedModel<T>& m, int game_idx) {
+        T numerator1 = 0.0, numerator2 = 0.0, denominator = 0.0;
+        for (int k = 0; k < count; k++) {
+            int distance = count - 1 - k;
+            const T& weight = game[k] == game_idx ? m.same[distance] : m.cross[distance];
+            numerator1 += G_A[k] * weight;
+            numerator2 += G_B[k] * weight;
+            denominator += weight;
+        }
+        M_A = (denominator != 0) ? numerator1 / denominator : T(0.0);
+        M_B = (denominator != 0) ? numerator2 / denominator : T(0.0);
+    }
+
+    T pointProb(const BasicTunedModel<T>& m) const {
+        using std::abs;
+        T M1 = abs(M_A), M2 = abs(M_B);
+        T elo1 = m.eloA(M1, M2 - M1);
+        T elo2 = m.eloB(M2, M1 - M2);
+        return elo1 / (elo1 + elo2);
+    }
+};
+
+// 值迭代的收敛判据：两次迭代之差
+inline double iterationDistance(double a, double b) { return std::abs(a - b); }
+
+// ExactSolver 的运行期参数版本：状态、平分折叠和值迭代都相同，只是窗口长度和公式来自 BasicTunedModel
+template <class T>
+struct BasicTunedSolver {
+    static const int SCORE_DIM = 12;
+    struct Value {
+        T p1 = 0.0;   // A 赢下本局的概率
+        T cnt = 0.0;  // 本局剩余分数的期望
+        bool done = false;
+    };
+
+    const BasicTunedModel<T>* model = nullptr;
+    int game_idx = -1;
+    int step_dim = 0, mask = 0;
+    BasicTunedWindow<T> seed;
+    std::vector<Value> memo;
+
+    int index(int a, int b, int step, int bits) const {
+        return ((a * SCORE_DIM + b) * step_dim + step) * (mask + 1) + bits;
+    }
+
+    void reset(const BasicTunedModel<T>& m, const BasicTunedWindow<T>& w, int g_idx) {
+        model = &m;
+        game_idx = g_idx;
+        seed = w;
+        step_dim = m.window + 1;
+        mask = (1 << m.window) - 1;
+        memo.assign(SCORE_DIM * SCORE_DIM * step_dim * (mask + 1), Value());
+    }
+
+    T point_prob(int step, int bits) const {
+        using std::abs;
+        BasicTunedWindow<T> window = seed;
+        for (int k = step - 1; k >= 0; k--) {
+            T M1 = abs(window.M_A), M2 = abs(window.M_B);
+            T elo1 = model->eloA(M1, M2 - M1);
+            T elo2 = model->eloB(M2, M1 - M2);
+            if (bits >> k & 1) window.push(*model, elo1, 0.0, game_idx);
+            else window.push(*model, 0.0, -elo2, game_idx);
+            window.update_momentum(*model, game_idx);
+        }
+        return window.pointProb(*model);
+    }
+
+    void solve_deuce() {
+        const int W = model->window;
+        const int scores[3][2] = {{10, 10}, {11, 10}, {10, 11}};
+        std::vector<T> prob(mask + 1);
+        for (int bits = 0; bits <= mask; bits++) prob[bits] = point_prob(W, bits);
+        for (int iter = 0; iter < 100000; iter++) {
+            double diff = 0;
+            for (auto& sc : scores) {
+                for (int bits = 0; bits <= mask; bits++) {
+                    const T& p = prob[bits];
+                    Value win = child(sc[0] + 1, sc[1], W, (bits << 1 & mask) | 1);
+                    Value lose = child(sc[0], sc[1] + 1, W, bits << 1 & mask);
+                    Value& v = memo[index(sc[0], sc[1], W, bits)];
+                    T p1 = p * win.p1 + (1 - p) * lose.p1;
+                    T cnt = 1 + p * win.cnt + (1 - p) * lose.cnt;
+                    diff = std::max(diff, std::max(iterationDistance(p1, v.p1), iterationDistance(cnt, v.cnt)));
+                    v.p1 = p1, v.cnt = cnt;
+                }
+            }
+            if (diff < 1e-15) break;
+        }
+        for (auto& sc : scores)
+            for (int bits = 0; bits <= mask; bits++) memo[index(sc[0], sc[1], W, bits)].done = true;
+    }
+
+    Value child(int a, int b, int step, int bits) const {
+        int over = isGameOver(a, b);
+        if (over) return {over == 1 ? 1.0 : 0.0, 0.0, true};
+        ExactSolver::fold(a, b);
+        return memo[index(a, b, step, bits)];
+    }
+
+    Value solve(int a, int b, int step, int bits) {
+        int over = isGameOver(a, b);
+        if (over) return {over == 1 ? 1.0 : 0.0, 0.0, true};
+        ExactSolver::fold(a, b);
+        Value& v = memo[index(a, b, step, bits)];
+        if (v.done) return v;
+        if (a >= 10 && b >= 10 && step == model->window) {
+            solve_deuce();
+            return memo[index(a, b, step, bits)];
+        }
+        T p = point_prob(step, bits);
+        int next_step = std::min(step + 1, model->window);
+        Value win = solve(a + 1, b, next_step, (bits << 1 & mask) | 1);
+        Value lose = solve(a, b + 1, next_step, bits << 1 & mask);
+        Value& res = memo[index(a, b, step, bits)];
+        res.p1 = p * win.p1 + (1 - p) * lose.p1;
+        res.cnt = 1 + p * win.cnt + (1 - p) * lose.cnt;
+        res.done = true;
+        return res;
+    }
+};
+
+using TunedModel = BasicTunedModel<double>;
+using TunedWindow = BasicTunedWindow<double>;
+using TunedSolver = BasicTunedSolver<double>;
+
+/******************************tuned model************************************/
+
+/******************************objective**************************************/
+
+// 负对数似然，分开记录逐分和逐局两部分
+struct Loss {
+    double points_nll = 0.0, games_nll = 0.0;
+    long long points = 0, games = 0;
+
+    double total() const { return points_nll + games_nll; }
+    void add(const Loss& o) {
+        points_nll += o.points_nll, games_nll += o.games_nll;
+        points += o.points, games += o.games;
+    }
+};
+
+inline double nll(double p, bool happened) {
+    p = std::min(1.0 - 1e-12, std::max(1e-12, p));
+    return -std::log(happened ? p : 1.0 - p);
+}
+
+// 按 analyseMatch 的流程在真实历史上重放一场比赛
+inline Loss evaluateMatch(const TunedModel& m, const MatchRecord& match, TunedSolver& solver) {
+    Loss loss;
+    TunedWindow history;  // 真实比赛最近 window 分（不分局），末尾势能即 calc_momentum 的结果
+    for (int game_idx = 0; game_idx < match.games(); ++game_idx) {
+        std::string_view seq = match.game(game_idx);
+        if (seq.empty()) continue;
+        int scrA = 0, scrB = 0;
+        for (char winner : seq) scrA += winner == playerA.id;
+        bool game_won = scrA * 2 > (int)seq.size();
+        scrA = 0;
+
+        for (char winner : seq) {
+            // 模拟使用的历史：最近 window 分中属于上一局和本局的分（windowAt）
+            TunedWindow seed;
+            for (int k = 0; k < history.count; k++)
+                if (history.game[k] >= game_idx - 1) seed.push(m, history.G_A[k], history.G_B[k], history.game[k]);
+            if (seed.count) seed.M_A = history.M_A, seed.M_B = history.M_B;
+
+            solver.reset(m, seed, game_idx);
+            TunedSolver::Value now = solver.solve(scrA, scrB, 0, 0);
+            if (scrA == 0 && scrB == 0) {
+                loss.games_nll += nll(now.p1, game_won);
+                loss.games++;
+            }
+            bool won = winner == playerA.id;
+            loss.points_nll += nll(seed.pointProb(m), won);
+            loss.points++;
+
+            double rtwp_win = solver.solve(scrA + 1, scrB, 0, 0).p1;
+            double rtwp_lose = solver.solve(scrA, scrB + 1, 0, 0).p1;
+            double L = Core::leverage(rtwp_win, rtwp_lose, now.cnt);
+            history.push(m, won ? L : 0.0, won ? 0.0 : -L, game_idx);
+            history.update_momentum(m, game_idx);
+            if (won) scrA++;
+            else scrB++;
+        }
+    }
+    return loss;
+}
+
+// 在数据集上求候选参数的损失；候选 × 比赛 一起并行。缓存按比赛存放，键为这场比赛实际读到的有效系数，
+// 只改动读不到的衰减项（如窗口为 1 时的 alpha / beta、单局比赛的 beta）的候选直接复用已算过的比赛
+class Calibrator {
+public:
+    long long candidates = 0, evaluated = 0, cache_hits = 0;  // 后两项按 候选 × 比赛 计
+
+    explicit Calibrator(std::vector<MatchRecord> data) : matches(std::move(data)) {
+        for (const MatchRecord& match : matches) {
+            int played = 0;
+            for (int g = 0; g < match.games(); g++) played += !match.game(g).empty();
+            cross_games.push_back(played >= 2);
+        }
+    }
+
+    std::vector<Loss> evaluate(const std::vector<Params>& params) {
+        int n = params.size(), n_matches = matches.size();
+        std::vector<TunedModel> models;
+        for (const Params& p : params) models.emplace_back(p);
+        std::vector<std::pair<int, TunedModel::Key>> keys;  // 第 i 个候选的第 k 场比赛为 keys[i * n_matches + k]
+        std::vector<int> todo;                              // 需要计算的 候选 × 比赛（去重后）
+        std::set<std::pair<int, TunedModel::Key>> pending;
+        for (int i = 0; i < n; i++) {
+            for (int k = 0; k < n_matches; k++) {
+                keys.emplace_back(k, models[i].key(cross_games[k]));
+                if (cache.count(keys.back()) || !pending.insert(keys.back()).second) {
+                    cache_hits++;
+                    continue;
+                }
+                todo.push_back(i * n_matches + k);
+            }
+        }
+        candidates += n;
+
+        std::vector<Loss> partial(todo.size());
+        std::function<void(int)> task = [&](int t) {
+            thread_local TunedSolver solver;
+            int c = todo[t] / n_matches, k = todo[t] % n_matches;
+            partial[t] = evaluateMatch(models[c], matches[k], solver);
+        };
+        int tasks = todo.size();
+        if (pool) pool->parallel_for(tasks, task);
+        else for (int t = 0; t < tasks; t++) task(t);
+        for (int t = 0; t < tasks; t++) cache[keys[todo[t]]] = partial[t];
+        evaluated += tasks;
+
+        std::vector<Loss> out(n);
+        for (int i = 0; i < n; i++)
+            for (int k = 0; k < n_matches; k++) out[i].add(cache[keys[i * n_matches + k]]);
+        return out;
+    }
+
+    Loss evaluate(const Params& p) { return evaluate(std::vector<Params>{p})[0]; }
+
+private:
+    std::vector<MatchRecord> matches;
+    std::vector<bool> cross_games;  // 比赛是否读得到跨局衰减（至少两局有分）
+    std::map<std::pair<int, TunedModel::Key>, Loss> cache;
+};
+
+/******************************objective**************************************/
+
+/******************************search*****************************************/
+
+struct SearchResult {
+    Params best;
+    Loss loss;
+};
+
+// 网格：窗口长度 × alpha × beta，其余参数取起点的值
+inline SearchResult gridSearch(Calibrator& cal, const Params& start, int points) {
+    std::vector<Params> grid;
+    for (int window = 1; window <= MAX_WINDOW; window++)
+        for (int i = 0; i < points; i++)
+            for (int j = 0; j < points; j++) {
+                Unit u = toUnit(start);
+                u[P_ALPHA] = (i + 0.5) / points;
+                u[P_BETA] = (j + 0.5) / points;
+                grid.push_back(fromUnit(u, window));
+            }
+    grid.push_back(start);
+    std::vector<Loss> losses = cal.evaluate(grid);
+    size_t best = 0;
+    for (size_t i = 1; i < grid.size(); i++)
+        if (losses[i].total() < losses[best].total()) best = i;
+    return {grid[best], losses[best]};
+}
+
+// Nelder-Mead（窗口长度固定）。每一轮的反射、扩展、外收缩、内收缩四个试探点一起并行求值，
+// 收缩时 n 个顶点一起求值；决策规则与标准 Nelder-Mead 相同
+inline SearchResult nelderMead(Calibrator& cal, const Params& start, int max_evals) {
+    const int n = N_PARAMS;
+    const int window = start.window;
+    std::vector<Unit> x(n + 1, toUnit(start));
+    for (int i = 0; i < n; i++) x[i + 1][i] += x[i + 1][i] + 0.1 > 1.0 ? -0.1 : 0.1;
+    auto clampUnit = [](Unit u) {
+        for (double& t : u) t = std::min(1.0, std::max(0.0, t));
+        return u;
+    };
+    auto evalUnits = [&](const std::vector<Unit>& us) {
+        std::vector<Params> ps;
+        for (const Unit& u : us) ps.push_back(fromUnit(u, window));
+        std::vector<Loss> losses = cal.evaluate(ps);
+        std::vector<double> f;
+        for (const Loss& l : losses) f.push_back(l.total());
+        return f;
+    };
+    std::vector<double> f = evalUnits(x);
+    int evals = n + 1;
+
+    while (evals < max_evals) {
+        std::vector<int> order(n + 1);
+        for (int i = 0; i <= n; i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return f[a] < f[b]; });
+        std::vector<Unit> xs;
+        std::vector<double> fs;
+        for (int i : order) xs.push_back(x[i]), fs.push_back(f[i]);
+        x = xs, f = fs;
+
+        double size = 0;
+        for (int i = 1; i <= n; i++)
+            for (int d = 0; d < n; d++) size = std::max(size, std::abs(x[i][d] - x[0][d]));
+        if (size < 1e-6 || f[n] - f[0] < 1e-10 * (1 + std::abs(f[0]))) break;
+
+        Unit c{};
+        for (int i = 0; i < n; i++)
+            for (int d = 0; d < n; d++) c[d] += x[i][d] / n;
+        auto along = [&](double t) {
+            Unit u;
+            for (int d = 0; d < n; d++) u[d] = c[d] + t * (c[d] - x[n][d]);
+            return clampUnit(u);
+        };
+        std::vector<Unit> trial = {along(1.0), along(2.0), along(0.5), along(-0.5)};
+        std::vector<double> ft = evalUnits(trial);
+        evals += trial.size();
+        double fr = ft[0], fe = ft[1], foc = ft[2], fic = ft[3];
+
+        bool shrink = false;
+        if (fr < f[0]) {
+            if (fe < fr) x[n] = trial[1], f[n] = fe;
+            else x[n] = trial[0], f[n] = fr;
+        } else if (fr < f[n - 1]) {
+            x[n] = trial[0], f[n] = fr;
+        } else if (fr < f[n]) {
+            if (foc <= fr) x[n] = trial[2], f[n] = foc;
+            else shrink = true;
+        } else {
+            if (fic < f[n]) x[n] = trial[3], f[n] = fic;
+            else shrink = true;
+        }
+        if (shrink) {
+            std::vector<Unit> shrunk;
+            for (int i = 1; i <= n; i++) {
+                for (int d = 0; d < n; d++) x[i][d] = x[0][d] + 0.5 * (x[i][d] - x[0][d]);
+                shrunk.push_back(x[i]);
+            }
+            std::vector<double> fsh = evalUnits(shrunk);
+            evals += n;
+            for (int i = 1; i <= n; i++) f[i] = fsh[i - 1];
+        }
+    }
+    int best = std::min_element(f.begin(), f.end()) - f.begin();
+    Params p = fromUnit(x[best], window);
+    return {p, cal.evaluate(p)};
+}
+
+// CMA-ES 风格的进化策略（窗口长度固定）：对角协方差（sep-CMA），秩 μ 更新 + 累积步长控制。
+// 每一代的 λ 个候选一起并行求值
+inline SearchResult cmaes(Calibrator& cal, const Params& start, int max_evals, double sigma = 0.1) {
+    const int n = N_PARAMS;
+    const int window = start.window;
+    const int lambda = 4 + (int)(3 * std::log(n));
+    const int mu = lambda / 2;
+    std::vector<double> w(mu);
+    double w_sum = 0, w_sq = 0;
+    for (int i = 0; i < mu; i++) w[i] = std::log(mu + 0.5) - std::log(i + 1.0), w_sum += w[i];
+    for (double& wi : w) wi /= w_sum, w_sq += wi * wi;
+    const double mu_eff = 1.0 / w_sq;
+    const double c_sigma = (mu_eff + 2) / (n + mu_eff + 5);
+    const double d_sigma = 1 + c_sigma + 2 * std::max(0.0, std::sqrt((mu_eff - 1) / (n + 1)) - 1);
+    const double c_mu = std::min(1.0, (n + 2) / 3.0 * 2 * (mu_eff - 2 + 1 / mu_eff) / ((n + 2) * (n + 2) + mu_eff));
+    const double chi_n = std::sqrt(n) * (1 - 1.0 / (4 * n) + 1.0 / (21 * n * n));
+
+    std::mt19937_64 gen(rng_seed);
+    std::normal_distribution<double> normal;
+    Unit mean = toUnit(start), diag, path{};
+    diag.fill(1.0);
+    SearchResult best{start, cal.evaluate(start)};
+    int evals = 1;
+
+    while (evals + lambda <= max_evals && sigma > 1e-8) {
+        std::vector<Unit> z(lambda), y(lambda), x(lambda);
+        std::vector<Params> ps;
+        for (int k = 0; k < lambda; k++) {
+            for (int d = 0; d < n; d++) {
+                z[k][d] = normal(gen);
+                y[k][d] = std::sqrt(diag[d]) * z[k][d];
+                x[k][d] = std::min(1.0, std::max(0.0, mean[d] + sigma * y[k][d]));
+            }
+            ps.push_back(fromUnit(x[k], window));
+        }
+        std::vector<Loss> losses = cal.evaluate(ps);
+        evals += lambda;
+        std::vector<int> order(lambda);
+        for (int k = 0; k < lambda; k++) order[k] = k;
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return losses[a].total() < losses[b].total(); });
+        if (losses[order[0]].total() < best.loss.total()) best = {ps[order[0]], losses[order[0]]};
+
+        Unit z_w{}, y2_w{};
+        for (int i = 0; i < mu; i++) {
+            int k = order[i];
+            for (int d = 0; d < n; d++) {
+                z_w[d] += w[i] * z[k][d];
+                y2_w[d] += w[i] * y[k][d] * y[k][d];
+            }
+        }
+        for (int d = 0; d < n; d++) {
+            double m = 0;
+            for (int i = 0; i < mu; i++) m += w[i] * x[order[i]][d];
+            mean[d] = m;
+        }
+        double path_norm = 0;
+        for (int d = 0; d < n; d++) {
+            path[d] = (1 - c_sigma) * path[d] + std::sqrt(c_sigma * (2 - c_sigma) * mu_eff) * z_w[d];
+            path_norm += path[d] * path[d];
+            diag[d] = (1 - c_mu) * diag[d] + c_mu * y2_w[d];
+        }
+        sigma *= std::exp(c_sigma / d_sigma * (std::sqrt(path_norm) / chi_n - 1));
+    }
+    return best;
+}
+
+/******************************search*****************************************/
+
+inline void printParams(std::ostream& out, const Params& before, const Params& after) {
+    out << std::fixed << std::setprecision(6);
+    out << "param\t\tmodel\t\tcalibrated\n";
+    out << "WINDOW_SIZE\t" << before.window << "\t\t" << after.window << "\n";
+    for (int i = 0; i < N_PARAMS; i++) {
+        std::string name = PARAM_SPECS[i].name;
+        out << name << (name.size() < 8 ? "\t\t" : "\t") << before.x[i] << "\t" << after.x[i] << "\n";
+    }
+}
+
+inline void printLoss(std::ostream& out, const std::string& name, const Loss& loss) {
+    out << std::fixed << std::setprecision(6) << name << ": loss " << loss.total()
+        << " (points " << loss.points_nll / std::max(1LL, loss.points) << "/pt over " << loss.points
+        << ", games " << loss.games_nll / std::max(1LL, loss.games) << "/game over " << loss.games << ")\n";
+}
+
+// 读入 --input= 指定的逐分数据，未指定时用内置比赛
+inline bool loadMatches(std::vector<MatchRecord>& matches) {
+    if (input_path.empty()) {
+        matches.push_back(matchFromGames(get_game_score_seqs()));
+        return true;
+    }
+    std::ifstream file;
+    if (input_path != "-") {
+        file.open(input_path, std::ios::binary);
+        if (!file) {
+            std::cerr << "cannot open " << input_path << "\n";
+            return false;
+        }
+    }
+    MatchReader reader(input_path == "-" ? std::cin : file);
+    return reader.readAll([&](const MatchRecord& match) { matches.push_back(match); }) >= 0;
+}
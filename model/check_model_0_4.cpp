@@ -0,0 +1,231 @@
+// model_0_4 自检：在内置比赛上把各条快速路径与它的参考路径逐项对比，全部一致时返回 0
+// 编译：g++ -O2 -std=c++17 -pthread check_model_0_4.cpp -o check_model_0_4
+// 运行：./check_model_0_4 [--seed=S]（默认种子 1，结果与运行时间无关）
+// 用 --exact 求胜率的检查逐位比较；需要蒙特卡洛的检查用固定种子，同样逐位比较（模拟预算与默认 L 的对比除外，按模拟误差容限）
+#include "calibrate_model_0_4.hpp"
+#include "model_0_4_drivers.hpp"
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    std::cerr << (ok ? "ok    " : "FAIL  ") << what << "\n";
+    if (!ok) failures++;
+}
+
+// 两份逐分结果的所有列逐位相同
+bool sameResult(const MatchResult& a, const MatchResult& b) {
+    return a.point == b.point && a.game == b.game && a.score_a == b.score_a && a.score_b == b.score_b &&
+           a.L == b.L && a.G_A == b.G_A && a.G_B == b.G_B && a.M_A == b.M_A && a.M_B == b.M_B &&
+           a.elo_A == b.elo_A && a.elo_B == b.elo_B && a.P_match == b.P_match && a.L_match == b.L_match &&
+           a.L_se == b.L_se && a.L_ci == b.L_ci;
+}
+
+// 测试期间临时改动全局选项，析构时恢复
+template <class T>
+struct Override {
+    T& ref;
+    T saved;
+    Override(T& ref, T value) : ref(ref), saved(ref) { ref = value; }
+    ~Override() { ref = saved; }
+};
+
+/******************************incremental************************************/
+
+// 改正 / 插入一分后的增量结果，与每次都从第一分重算整场（stop_on_converge = false）的结果相同；
+// 改正还与对改正后的比赛从头分析的结果相同（分序号即随机数流序号，二者一致）
+void checkIncremental(const MatchRecord& match) {
+    Override<SolverMode> exact(solver_mode, SolverMode::Exact);
+    Override<int> bo7(best_of, 7);
+    size_t n = match.points.size();
+    size_t game_start = match.game_end[0], mid_game = game_start + 7, last = n - 1;
+    for (size_t i : {game_start, mid_game, last}) {
+        char flipped = match.points[i] == playerA.id ? playerB.id : playerA.id;
+        std::string at = " at point " + std::to_string(i);
+
+        IncrementalMatch inc(match, 0), ref(match, 0);
+        ref.stop_on_converge = false;
+        inc.amend(i, flipped);
+        ref.amend(i, flipped);
+        check(sameResult(inc.result(), ref.result()), "IncrementalMatch::amend == full recompute" + at);
+
+        MatchRecord amended = match;
+        amended.points[i] = flipped;
+        MatchContext ctx;
+        MatchResult scratch;
+        analyseMatch(ctx, amended, &scratch);
+        check(sameResult(inc.result(), scratch), "IncrementalMatch::amend == analyseMatch on the amended match" + at);
+
+        IncrementalMatch ins(match, 0), ins_ref(match, 0);
+        ins_ref.stop_on_converge = false;
+        ins.insert(i, flipped);
+        ins_ref.insert(i, flipped);
+        check(sameResult(ins.result(), ins_ref.result()), "IncrementalMatch::insert == full recompute" + at);
+    }
+    IncrementalMatch inc(match, 0);
+    IncrementalMatch tail(match, 0), tail_ref(match, 0);
+    tail_ref.stop_on_converge = false;
+    tail.insert(n, playerA.id);
+    tail_ref.insert(n, playerA.id);
+    check(sameResult(tail.result(), tail_ref.result()), "IncrementalMatch::insert at the end == full recompute");
+    check(inc.amend(n, playerA.id) == -1 && inc.insert(n + 1, playerA.id) == -1 && inc.size() == n,
+          "IncrementalMatch rejects out-of-range points");
+}
+
+/******************************incremental************************************/
+
+/******************************match odds*************************************/
+
+// 整场胜率的参考：局分 i:j 起逐局递归（不记忆），need 为赢下整场需要的局数
+double matchProbBrute(int need, double q, int i, int j) {
+    if (i == need) return 1.0;
+    if (j == need) return 0.0;
+    return q * matchProbBrute(need, q, i + 1, j) + (1 - q) * matchProbBrute(need, q, i, j + 1);
+}
+
+// MatchOdds 的表与逐局递归一致；赛制内每个局分都比较。
+// 另在内置比赛上：最后一分打完整场已分胜负，P_match 为 1（A 胜）或 0
+void checkMatchOdds(const MatchRecord& match) {
+    double worst = 0;
+    for (int bo : {1, 3, 5, 7})
+        for (double q : {0.0, 0.27, 0.5, 0.61, 1.0}) {
+            MatchOdds odds(bo, q);
+            int need = bo / 2 + 1;
+            for (int i = 0; i <= need; i++)
+                for (int j = 0; j <= need; j++)
+                    if (i < need || j < need) worst = std::max(worst, std::abs(odds.value(i, j) - matchProbBrute(need, q, i, j)));
+        }
+    check(worst < 1e-12, "MatchOdds == game-by-game recursion (max diff " + std::to_string(worst) + ")");
+
+    Override<SolverMode> exact(solver_mode, SolverMode::Exact);
+    Override<int> bo7(best_of, 7);
+    MatchContext ctx;
+    MatchResult result;
+    analyseMatch(ctx, match, &result);
+    int won_a = 0;
+    for (size_t g = 0; g < match.game_end.size(); g++) won_a += match.game(g).back() == playerA.id;
+    double final_prob = won_a * 2 > (int)match.game_end.size() ? 1.0 : 0.0;
+    check(!result.P_match.empty() && result.P_match.back() == final_prob, "P_match is settled after the last point");
+}
+
+/******************************match odds*************************************/
+
+/******************************speculative************************************/
+
+// spec_tol = 0 时推测并行只采用输入逐位相同的结果，逐分结果与顺序重放相同。
+// 精确求解比整场，蒙特卡洛只比前两局（控制运行时间）；宽度不整除分数，覆盖最后一轮不满的情况
+void checkSpeculative(const MatchRecord& match) {
+    Override<int> bo7(best_of, 7);
+    Override<double> tol(spec_tol, 0.0);
+    MatchRecord two_games = matchFromGames({std::string(match.game(0)), std::string(match.game(1))});
+    for (SolverMode mode : {SolverMode::Exact, SolverMode::MonteCarlo}) {
+        Override<SolverMode> solver(solver_mode, mode);
+        const MatchRecord& record = mode == SolverMode::Exact ? match : two_games;
+        MatchContext ctx;
+        MatchResult sequential, speculative;
+        analyseMatch(ctx, record, &sequential);
+        {
+            Override<int> width(spec_width, 5);
+            analyseMatch(ctx, record, &speculative);
+        }
+        check(sameResult(sequential, speculative), std::string("speculative == sequential (") +
+                                                       (mode == SolverMode::Exact ? "exact" : "monte carlo") + ")");
+    }
+}
+
+/******************************speculative************************************/
+
+/******************************budget*****************************************/
+
+// 模拟预算的分配：不超支、每分不少于 ADAPTIVE_BLOCK 次；预算恰为下限时每分正好 ADAPTIVE_BLOCK 次，
+// 低于下限时按下限超支并计入 short_matches；预算为默认的 3 × 10000 次 × 分数时 L 与默认的差在模拟误差以内
+void checkBudget(const MatchRecord& match) {
+    Override<int> bo7(best_of, 7);
+    Override<SolverMode> mc(solver_mode, SolverMode::MonteCarlo);
+    long long n = match.points.size(), floor = 3LL * ADAPTIVE_BLOCK * n;
+    auto run = [&](long long budget, BudgetObjective objective, MatchResult* result) {
+        Override<long long> total(rollout_budget, budget);
+        Override<BudgetObjective> obj(budget_objective, objective);
+        budget_stats.matches = budget_stats.requested = budget_stats.used = budget_stats.short_matches = 0;
+        budget_stats.min_rollouts = LLONG_MAX, budget_stats.max_rollouts = 0;
+        MatchContext ctx;
+        analyseMatch(ctx, match, result);
+    };
+    for (BudgetObjective objective : {BudgetObjective::Leverage, BudgetObjective::Momentum}) {
+        std::string name = objective == BudgetObjective::Leverage ? " (leverage)" : " (momentum)";
+        for (long long budget : {floor * 10, 30000 * n}) {
+            run(budget, objective, nullptr);
+            check(budget_stats.used <= budget && budget_stats.min_rollouts >= ADAPTIVE_BLOCK && !budget_stats.short_matches,
+                  "budget " + std::to_string(budget) + " is not overspent" + name);
+        }
+        run(floor, objective, nullptr);
+        check(budget_stats.used == floor && budget_stats.min_rollouts == ADAPTIVE_BLOCK &&
+                  budget_stats.max_rollouts == ADAPTIVE_BLOCK && !budget_stats.short_matches,
+              "minimum budget gives every point ADAPTIVE_BLOCK rollouts" + name);
+        run(floor - 1, objective, nullptr);
+        check(budget_stats.used == floor && budget_stats.short_matches == 1,
+              "budget below the minimum overspends to it and is reported" + name);
+    }
+
+    MatchContext ctx;
+    MatchResult plain, budgeted;
+    analyseMatch(ctx, match, &plain);
+    run(30000 * n, BudgetObjective::Leverage, &budgeted);
+    double sq = 0;
+    for (size_t i = 0; i < plain.size(); i++) sq += (plain.L[i] - budgeted.L[i]) * (plain.L[i] - budgeted.L[i]);
+    double rms = std::sqrt(sq / plain.size());
+    check(rms < 3e-3, "budget 3 x 10000 x points gives the default L (rms diff " + std::to_string(rms) + ")");
+}
+
+/******************************budget*****************************************/
+
+/******************************calibrate**************************************/
+
+// 校准的缓存：每个候选的损失与逐场直接调用 evaluateMatch 之和逐位相同，第二次求值全部命中缓存。
+// 候选两两只差 alpha 或 beta（缓存键会因读不到而去掉的量）；数据含单局比赛和中间空一局的比赛，
+// 后者的真实历史跨过空局读到再前一局，beta 不同时损失不同、不能共用缓存
+void checkCalibrate(const MatchRecord& match) {
+    std::vector<std::string> g = {std::string(match.game(0)), std::string(match.game(1)), std::string(match.game(2))};
+    std::vector<MatchRecord> data = {matchFromGames(g), matchFromGames({g[0]}), matchFromGames({g[0], "", g[2]})};
+    std::vector<Params> params;
+    for (int window : {1, 3})
+        for (double alpha : {0.2, 0.6})
+            for (double beta : {0.3, 0.7}) {
+                Params p = modelParams();
+                p.window = window, p.x[P_ALPHA] = alpha, p.x[P_BETA] = beta;
+                params.push_back(p);
+            }
+
+    Calibrator cal(data);
+    std::vector<Loss> cached = cal.evaluate(params);
+    long long evaluated = cal.evaluated;
+    std::vector<Loss> again = cal.evaluate(params);
+    bool same = true;
+    TunedSolver solver;
+    for (size_t i = 0; i < params.size(); i++) {
+        Loss direct;
+        for (const MatchRecord& m : data) direct.add(evaluateMatch(TunedModel(params[i]), m, solver));
+        for (const Loss& l : {cached[i], again[i]})
+            same &= l.points_nll == direct.points_nll && l.games_nll == direct.games_nll && l.points == direct.points &&
+                    l.games == direct.games;
+    }
+    check(same, "Calibrator cached loss == evaluateMatch (" + std::to_string(evaluated) + " of " +
+                    std::to_string(params.size() * data.size()) + " evaluated)");
+    check(cal.evaluated == evaluated, "Calibrator reuses every loss on the second pass");
+}
+
+/******************************calibrate**************************************/
+
+int main(int argc, char* argv[]) {
+    rng_seed = 1;
+    parseArgs(argc, argv);
+    MatchRecord match = matchFromGames(get_game_score_seqs());
+
+    checkIncremental(match);
+    checkMatchOdds(match);
+    checkSpeculative(match);
+    checkBudget(matchFromGames({std::string(match.game(0)), std::string(match.game(1))}));
+    checkCalibrate(match);
+
+    std::cerr << (failures ? std::to_string(failures) + " checks failed\n" : std::string("all checks passed\n"));
+    return failures ? 1 : 0;
+}
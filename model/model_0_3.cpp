@@ -9,6 +9,8 @@
 #include <sstream>
 #include <tuple>
 
+#include "momentum_core.hpp"
+
 // 随机数生成器
 std::mt19937 gen(std::chrono::system_clock().now().time_since_epoch().count());
 using PDD = std::pair<double, double>;
@@ -36,10 +38,13 @@ struct PointInfo {
 
 std::vector<PointInfo> all_points;
 
+// 本版本的模型公式（见 momentum_core.hpp）
+using Core = momentum::Model03;
+
 // 常量定义
-const double alpha = 0.33;    // 当前局内衰减系数
-const double beta = 0.5;      // 跨局衰减系数
-const int WINDOW_SIZE = 5;    // 势能计算窗口
+const double alpha = Core::Decay::alpha;    // 当前局内衰减系数
+const double beta = Core::Decay::beta;      // 跨局衰减系数
+const int WINDOW_SIZE = Core::WINDOW_SIZE;  // 势能计算窗口
 
 // 初始化球员数据
 std::vector<Player> initializePlayers() {
@@ -67,93 +72,27 @@ const std::vector<std::string> get_game_score_seqs() {
 
 // 判断一局是否结束（乒乓球11分制，领先2分获胜）
 int isGameOver(int score1, int score2) {
-    int maxScore = std::max(score1, score2);
-    int minScore = std::min(score1, score2);
-    if (maxScore >= 11 && maxScore - minScore >= 2) {
-        return (score1 > score2) ? 1 : 2; // 1为A胜，2为B胜
-    }
-    return 0; // 未结束
+    return Core::isGameOver(score1, score2); // 1为A胜，2为B胜，0为未结束
 } // * passed
 
 // 计算elo评分
-double calculateEloRating(const Player& player, double M_self, double delta_M,
-                         double w_cap = 0.6, double w_M = 0.2, double w_delta_M = 0.2) {
-    double elo = (player.cap * w_cap + (M_self * w_M - delta_M * w_delta_M * (1 - player.psy))) * player.sta;
-    return std::max(0.0, std::min(1.0, elo));
+double calculateEloRating(const Player& player, double M_self, double delta_M) {
+    return Core::elo(player, M_self, delta_M);
 } // * passed
 
 // 计算momentum，返回的五个参数：M_A, M_B
 std::tuple<double, double> calc_momentum(std::vector<PointInfo>& points, int game_idx) {
-    if (points.empty()) return {0.0, 0.0};
-
-    double numerator1 = 0.0, numerator2 = 0.0, denominator = 0.0;
-    int start_idx = std::max(0, (int)points.size() - WINDOW_SIZE);
-
-    for (int k = start_idx; k < points.size(); k++) {
-        int distance = points.size() - 1 - k;
-        double decay = points[k].game_idx ? alpha : beta;
-        double weight = pow(decay, distance);
-        numerator1 += points[k].G_A * weight;
-        numerator2 += points[k].G_B * weight;
-        denominator += weight;
-    }
-
-    double M1 = (denominator != 0) ? numerator1 / denominator : 0.0;
-    double M2 = (denominator != 0) ? numerator2 / denominator : 0.0;
-    points.back().M_A = M1, points.back().M_B = M2;
-    return {M1, M2};
+    return Core::momentum(points, game_idx);
 }
 
 // 使用elo评分计算实时获胜概率（新增当前局索引和当前分索引参数）
 PDD winningRate(int scr1, int scr2, int game_idx) {
-    int batch_size = 10000;
-    int win1 = 0, win2 = 0;
-    for (int i = 1; i <= batch_size; i++) {
-        int cur_scr1 = scr1, cur_scr2 = scr2;
-        std::vector<PointInfo> sim_points;
-        for (auto p : all_points) {
-            if (p.game_idx < game_idx - 1) continue;
-            if (p.game_idx > game_idx) break;
-            sim_points.emplace_back(p);
-        }
-        while (!isGameOver(cur_scr1, cur_scr2)) {
-            double current_M1, current_M2;
-            double current_delta_M1, current_delta_M2;
-            if (sim_points.empty()) {
-                current_M1 = current_M2 = current_delta_M1 = current_delta_M2 = 0;
-            } else {
-                PointInfo &p = sim_points.back();
-                current_M1 = std::abs(p.M_A);
-                current_M2 = std::abs(p.M_B);
-                current_delta_M1 = current_M2 - current_M1;
-                current_delta_M2 = current_M1 - current_M2;
-            }
-            double current_elo1 = calculateEloRating(playerA, current_M1, current_delta_M1);
-            double current_elo2 = calculateEloRating(playerB, current_M2, current_delta_M2);
-            std::uniform_real_distribution<double> distribution(0.0, current_elo1 + current_elo2);
-            double dice = distribution(gen);
-            if (dice <= current_elo1) {
-                cur_scr1++;
-                sim_points.emplace_back(current_elo1, 0.0, 0.0, 0.0, game_idx);
-            } else {
-                cur_scr2++;
-                sim_points.emplace_back(0.0, -current_elo2, 0.0, 0.0, game_idx);
-            }
-            calc_momentum(sim_points, game_idx);
-        }
-        if (isGameOver(cur_scr1, cur_scr2) == 1) {
-            win1++;
-        } else {
-            win2++;
-        }
-    }
-    return {1.0 * win1 / batch_size, 1.0 * win2 / batch_size};
+    auto [win1, win2, _] = Core::winningRate(all_points, playerA, playerB, scr1, scr2, game_idx, gen);
+    return {win1, win2};
 }
 
 double calc_leverage(int scr1, int scr2, int game_idx) {
-    double rtwp_win = winningRate(scr1 + 1, scr2, game_idx).first;
-    double rtwp_lose = winningRate(scr1, scr2 + 1, game_idx).first;
-    return rtwp_win - rtwp_lose;
+    return Core::calcLeverage(all_points, playerA, playerB, scr1, scr2, game_idx, gen);
 }
 
 int main() {
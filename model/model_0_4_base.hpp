@@ -0,0 +1,403 @@
+// model_0_4 的基础部分：随机数、球员和比赛上下文、运行选项、线程池、势能窗口和单条模拟
+// model_0_4 按层拆成几个头文件，工具只包含用到的那一层，main 在 model_0_4.cpp：
+//   model_0_4_base.hpp        基础部分
+//   model_0_4_estimators.hpp  胜率和杠杆的求解（含 base）
+//   model_0_4_io.hpp          逐分输入、文本和二进制结果（含 base）
+//   model_0_4_options.hpp     命令行参数（含 estimators、io）
+//   model_0_4_drivers.hpp     逐分分析、推测并行、模拟预算、增量、批量和实时模式（含 options）
+// 全局变量和函数都是 inline，多个编译单元同时包含也只有一份定义
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "momentum_core.hpp"
+
+using PDD = std::pair<double, double>;
+
+/******************************random numbers*********************************/
+
+// 随机数种子：默认取当前时间，可用 --seed= 指定以复现结果
+inline uint64_t rng_seed = std::chrono::system_clock().now().time_since_epoch().count();
+
+// Philox4x32-10 计数器型随机数：输出只由 (密钥, 计数器) 决定，任意一块都能单独算出
+struct Philox4x32 {
+    using Counter = std::array<uint32_t, 4>;
+    using Key = std::array<uint32_t, 2>;
+
+    static Counter block(Counter ctr, Key key) {
+        for (int round = 0; round < 10; round++) {
+            if (round > 0) key[0] += 0x9E3779B9u, key[1] += 0xBB67AE85u;
+            uint64_t p0 = (uint64_t)0xD2511F53u * ctr[0];
+            uint64_t p1 = (uint64_t)0xCD9E8D57u * ctr[2];
+            ctr = {(uint32_t)(p1 >> 32) ^ ctr[1] ^ key[0], (uint32_t)p1,
+                   (uint32_t)(p0 >> 32) ^ ctr[3] ^ key[1], (uint32_t)p0};
+        }
+        return ctr;
+    }
+};
+
+// 一次模拟的随机数流：密钥为种子，计数器为 (块序号, 模拟序号, 分序号, 比赛编号)。
+// 不同比赛/分/模拟天然落在互不重叠的计数器区间，并行时无需协调；复制一份即可重放同样的随机数。
+class PhiloxStream {
+public:
+    using result_type = uint32_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+
+    PhiloxStream(uint64_t seed, uint32_t match, uint32_t point, uint32_t rollout)
+        : key{(uint32_t)seed, (uint32_t)(seed >> 32)}, ctr{0, rollout, point, match} {}
+
+    result_type operator()() {
+        if (pos == 4) {
+            buf = Philox4x32::block(ctr, key);
+            ctr[0]++;
+            pos = 0;
+        }
+        return buf[pos++];
+    }
+
+private:
+    Philox4x32::Key key;
+    Philox4x32::Counter ctr;
+    Philox4x32::Counter buf{};
+    int pos = 4;
+};
+
+/******************************random numbers*********************************/
+
+// 球员结构体 - 存储球员数据
+struct Player {
+    std::string name;    // 球员名称
+    char id;             // 球员标识(H/F)
+    double cap;          // 基础实力
+    double psy;          // 心理素质
+    double sta;          // 状态系数
+    // double M_self;       // 自身势头
+};
+
+// 存储每一分的元数据（用于权重计算）
+struct PointInfo {
+    double G_A;       // A的杠杆获取量
+    double G_B;       // B的杠杆获取量
+    double M_A;       // 这一分后，A 的势能
+    double M_B;       // 这一分后，B 的势能
+    int game_idx;     // 所属局索引（0开始）
+    PointInfo(double ga, double gb, double ma, double mb, int g_idx)
+        : G_A(ga), G_B(gb), M_A(ma), M_B(mb), game_idx(g_idx) {}
+};
+
+inline std::atomic<unsigned long long> history_clock{0};  // 历史版本号的全局来源，保证不同比赛的版本号互不相同
+inline std::atomic<long long> rollout_count{0};           // 所有比赛累计的模拟次数（--exact 不计）
+
+// 一场比赛的分析状态。各函数只通过它读写历史，不同比赛的上下文可以在不同线程上同时分析
+struct MatchContext {
+    int match = 0;                          // 比赛编号，参与随机数流的计数器
+    std::vector<PointInfo> all_points;      // 已分析的真实分
+    unsigned long long history_version = 0; // all_points 每次变化时更新，用于判断依赖历史的缓存是否失效
+
+    uint32_t point_key = UINT32_MAX;        // 下一分随机数流的分序号，默认（UINT32_MAX）取 all_points 的长度
+
+    void touch() { history_version = ++history_clock; }
+
+    uint32_t pointKey() const { return point_key != UINT32_MAX ? point_key : all_points.size(); }
+
+    // 下一分的第 rollout 次模拟的随机数流
+    PhiloxStream rolloutStream(uint32_t rollout) const {
+        return PhiloxStream(rng_seed, match, pointKey(), rollout);
+    }
+};
+
+// 本版本的模型公式（见 momentum_core.hpp）
+using Core = momentum::Model04;
+// lockstep 内核和精确求解都按 同局/跨局 两类衰减和 11 分制展开
+static_assert(std::is_same_v<Core::Decay, momentum::DecaySameCross>, "lockstep 内核和精确求解只支持同局/跨局衰减");
+static_assert(std::is_same_v<Core::Elo, momentum::EloSigmoid>, "lockstep 内核只支持 sigmoid elo");
+static_assert(Core::Game::target == 11 && Core::Game::margin == 2, "精确求解和缓存按 11 分制折叠平分");
+
+// 常量定义
+constexpr double alpha = Core::Decay::alpha;    // 当前局内衰减系数
+constexpr double beta = Core::Decay::beta;      // 跨局衰减系数
+constexpr int WINDOW_SIZE = Core::WINDOW_SIZE;  // 势能计算窗口
+
+// 衰减权重表（编译期生成）：DECAY_SAME[d] = (1 - alpha)^d，DECAY_CROSS[d] = (1 - beta)^d，d 为与最近一分的距离
+constexpr auto DECAY_SAME = Core::decay_table[0];
+constexpr auto DECAY_CROSS = Core::decay_table[1];
+
+// 胜率求解方式
+enum class SolverMode {
+    MonteCarlo,  // 蒙特卡洛模拟（默认）
+    Exact        // 截断历史的动态规划，近似精确（见 ExactSolver）
+};
+inline SolverMode solver_mode = SolverMode::MonteCarlo;
+
+// 并行蒙特卡洛：0 表示单线程，>= 1 时按固定分块交给线程池
+inline int num_threads = 0;
+inline bool batch_mode = false;        // 批量模式：num_threads 个线程各自分析整场比赛，单场内部不再并行
+// calc_leverage 使用公共随机数融合估计（见 leverageCRN）。默认的三次 winningRate 已共用每分的随机数流，
+// --crn 只省掉当前比分那一次模拟：每分 2 × 10000 次而非 3 × 10000 次，约快 1.5 倍，L 与默认相差在 1e-3 以内
+inline bool use_crn = false;
+
+// 自适应停止：每次追加 ADAPTIVE_BLOCK 次模拟，直到标准误不超过 target_se 或达到 max_batch
+inline bool use_adaptive = false;
+inline double target_se = 0.005;       // 10000 次模拟在 p = 0.5 时的标准误
+inline int max_batch = 10000;
+const int MIN_BATCH = 200;
+const int ADAPTIVE_BLOCK = 100;
+
+// 方差缩减：对偶变量（每条随机数流再配一条 u -> 1 - u 的镜像流）和控制变量（见 winningRateReduced）。
+// 结束时报告的方差倍数是单次胜率 p 的，不是 L 的：默认的三次 winningRate 已共用随机数流，L 作为差值误差本来就小，
+// 参考比赛（--seed=3）上 L 相对 --exact 的 RMS：默认 1.34e-3，--antithetic 1.41e-3，--qmc 1.56e-3，
+// --importance 1.29e-3，只有 --control-variate 降到 0.51e-3
+inline bool use_antithetic = false;
+inline bool use_control_variate = false;
+inline bool use_importance = false;  // 重要性抽样：比分不平时向落后方倾斜每分的得分概率，按似然比加权
+
+// 随机化拟蒙特卡洛：每次模拟的前 QMC_DIM 个骰子取自随机平移的秩 1 格点（见 LatticeStream），
+// 共 qmc_replicates 组独立平移，由组间差异估计误差
+inline bool use_qmc = false;
+inline int qmc_points = 1024;             // 每组格点数
+inline int qmc_replicates = 8;
+const int QMC_DIM = 64;
+const int QMC_MIN_REPLICATES = 4;  // --adaptive 时至少的组数
+
+// 向量化批量模拟：off 为原始逐条模拟，auto 按 CPU 自动选择 AVX-512 / AVX2 / 通用版本
+enum class SimdLevel { Off, Auto, Generic, AVX2, AVX512 };
+inline SimdLevel simd_level = SimdLevel::Off;
+
+// 胜率缓存：键为 (折叠后的比分, 量化后的末尾势能, 最近一分的归属)，见 WinRateCache。
+// 参考比赛（117 分，351 次查询）上 0.02 的命中率为 23%，12 场批量为 69%；
+// 规范历史带来的偏差在 --exact 下约为 L 的 2e-5（RMSE），远小于 10000 次模拟的抽样误差。
+// --cache 是以精度换复用，不是单纯的记忆化：未命中时也在规范历史上求值，且随机数流由键决定，
+// 同一分的赢 / 输两个分支不再共用随机数流，噪声不再相互抵消。蒙特卡洛下即使命中率为 0，
+// L 对 --exact 的 RMSE 也从 1.34e-3 升到 1.61e-3（参考比赛，--seed=3；默认步长、23% 命中时为 1.50e-3）
+inline bool use_cache = false;
+inline double cache_quantum = 0.02;    // M 的量化步长
+inline size_t cache_capacity = 65536;  // 最多缓存的状态数，超出后按 LRU 淘汰
+const int MC_CHUNK_SIZE = 250;  // 每个分块的模拟次数，分块数与线程数无关
+
+// 比赛层面：N 局 (N+1)/2 胜制下的整场胜率和杠杆，0 表示不计算
+inline int best_of = 0;
+
+// 单场比赛内的推测并行（见 analyseMatchSpeculative）：每轮按估计的历史同时计算前方 spec_width 分，
+// 输入与最终历史相差不超过 spec_tol 的结果直接采用。0 表示关闭，--speculative 不带值时取 4 * 线程数
+inline int spec_width = 0;
+inline double spec_tol = 1e-6;
+
+// 全场模拟预算（见 analyseMatchBudgeted）：每场比赛共 rollout_budget 次模拟（三个比分合计），
+// 每分先少量试算，再按误差和重要性分配其余次数（每分至少 ADAPTIVE_BLOCK 次）。0 表示每分固定 3 × 10000 次
+inline long long rollout_budget = 0;
+enum class BudgetObjective {
+    Leverage,  // 最小化各分 L 的方差之和
+    Momentum   // 最小化势能曲线 M 的方差之和：L_i 按它在之后 WINDOW_SIZE 分的势能中的权重平方加权（默认）
+};
+inline BudgetObjective budget_objective = BudgetObjective::Momentum;
+
+// 逐分结果是否带 L 的置信区间：--adaptive 和方差缩减的胜率估计给出区间，
+// 精确求解、缓存、CRN 和模拟预算（它给出 L_se）的路径不带
+inline bool reportsInterval() {
+    return solver_mode == SolverMode::MonteCarlo && !use_cache && !use_crn && rollout_budget == 0 &&
+           (use_adaptive || use_antithetic || use_control_variate || use_qmc || use_importance);
+}
+
+// 简单线程池：parallel_for 把 [0, n) 的任务分给工作线程，调用线程也参与执行
+class ThreadPool {
+public:
+    explicit ThreadPool(int n) {
+        for (int i = 1; i < n; i++) workers.emplace_back([this] { worker_loop(); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto& t : workers) t.join();
+    }
+
+    void parallel_for(int n, const std::function<void(int)>& fn) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            task = &fn;
+            task_count = n;
+            next.store(0);
+            finished = 0;
+            generation++;
+        }
+        cv.notify_all();
+        int cnt = run_tasks(fn, n);
+        std::unique_lock<std::mutex> lock(mtx);
+        finished += cnt;
+        // 等所有任务完成且没有工作线程还停留在本轮，避免旧任务被下一轮的下标唤醒
+        done_cv.wait(lock, [&] { return finished == n && active == 0; });
+        task = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mtx;
+    std::condition_variable cv, done_cv;
+    const std::function<void(int)>* task = nullptr;
+    int task_count = 0;
+    int finished = 0;
+    int active = 0;
+    long long generation = 0;
+    bool stopping = false;
+    std::atomic<int> next{0};
+
+    int run_tasks(const std::function<void(int)>& fn, int n) {
+        int cnt = 0;
+        for (int i; (i = next.fetch_add(1)) < n; cnt++) fn(i);
+        return cnt;
+    }
+
+    void worker_loop() {
+        long long seen = 0;
+        while (true) {
+            const std::function<void(int)>* fn;
+            int n;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [&] { return stopping || (generation != seen && task); });
+                if (stopping) return;
+                seen = generation;
+                fn = task, n = task_count;
+                active++;
+            }
+            int cnt = run_tasks(*fn, n);
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                finished += cnt;
+                active--;
+            }
+            done_cv.notify_all();
+        }
+    }
+};
+inline std::unique_ptr<ThreadPool> pool;
+inline std::unique_ptr<ThreadPool> spec_pool;  // 推测并行时按分并行，此时 pool 为空，每一分内部不再并行
+
+// 初始化球员数据
+inline std::vector<Player> initializePlayers() {
+    return {
+        {"Player H", 'H', 0.45, 0.8, 0.9},
+        {"Player F", 'F', 0.55, 0.9, 0.9}
+    };
+} // * passed
+inline std::vector<Player> players = initializePlayers();
+inline Player& playerA = players[0];
+inline Player& playerB = players[1];
+
+// 按局拆分得分序列
+inline const std::vector<std::string> get_game_score_seqs() {
+    return {
+        "HFHHHHHHHHHFH",        // 第1局
+        "HHFFHFFFHHFHHHFFHFHH", // 第2局
+        "FFFFFFHHFHFFFHF",      // 第3局
+        "HFHFFHHHFFHHFFFFFF",   // 第4局
+        "HHHHFFHHHFHHFHH",      // 第5局
+        "FHFFHFFFHHFHHHFFFF",   // 第6局
+        "FFHHHHFFFFHHHFFFFF"    // 第7局
+    };
+} // * passed
+
+inline double sigmoid(double x) {
+    return Core::Elo::squash(x);
+}
+
+// 按本局剩余分数的期望给杠杆加权
+inline double calc_exponential_decay(double x) {
+    return Core::Leverage::weight(x);
+}
+
+// 判断一局是否结束（乒乓球11分制，领先2分获胜）
+constexpr int isGameOver(int score1, int score2) {
+    return Core::isGameOver(score1, score2); // 1为A胜，2为B胜，0为未结束
+} // * passed
+
+// 计算elo评分
+inline double calculateEloRating(const Player& player, double M_self, double delta_M) {
+    return Core::elo(player, M_self, delta_M);
+} // * passed
+
+// 计算momentum，返回的五个参数：M_A, M_B
+inline std::tuple<double, double> calc_momentum(std::vector<PointInfo>& points, int game_idx) {
+    return Core::momentum(points, game_idx);
+}
+
+// 势能窗口（见 momentum_core.hpp）：定长环形缓冲区，势能 O(1) 增量更新，真实比赛和模拟共用
+using MomentumWindow = Core::MomentumWindow;
+
+// 模拟里的骰子（见 momentum_core.hpp）：随机位流与 uniform_real_distribution 逐位相同，格点流直接取坐标
+using momentum::uniform01;
+
+// 根据窗口末尾的势能计算下一分 A 的得分概率
+inline double nextPointProb(const MomentumWindow& window) {
+    double M1 = std::abs(window.M_A), M2 = std::abs(window.M_B);
+    double elo1 = calculateEloRating(playerA, M1, M2 - M1);
+    double elo2 = calculateEloRating(playerB, M2, M1 - M2);
+    return elo1 / (elo1 + elo2);
+}
+
+// 模拟使用的历史：ctx.all_points[0, end) 中属于上一局和本局的最近 WINDOW_SIZE 分（见 Core::windowAt）
+inline MomentumWindow windowAt(const MatchContext& ctx, size_t end, int game_idx) {
+    return Core::windowAt(ctx.all_points, end, game_idx);
+}
+
+inline MomentumWindow get_sim_window(const MatchContext& ctx, int game_idx) {
+    return windowAt(ctx, ctx.all_points.size(), game_idx);
+}
+
+// 从给定历史出发模拟打完本局，返回 {胜者(1/2), 模拟的分数}
+template <class RNG>
+std::tuple<int, int> simulateGame(const MomentumWindow& window, int scr1, int scr2, int game_idx, RNG& rng) {
+    return Core::simulateGame(window, playerA, playerB, scr1, scr2, game_idx, rng);
+}
+
+// 使用elo评分计算实时获胜概率（新增当前局索引和当前分索引参数）
+inline std::tuple<double, double, double> winningRateMonteCarlo(const MatchContext& ctx, int scr1, int scr2, int game_idx) {
+    int batch_size = 10000;
+    int win1 = 0, win2 = 0;
+    double avg_cnt = 0;
+    MomentumWindow seed = get_sim_window(ctx, game_idx);
+    for (int i = 0; i < batch_size; i++) {
+        PhiloxStream rng = ctx.rolloutStream(i);
+        auto [winner, cnt] = simulateGame(seed, scr1, scr2, game_idx, rng);
+        avg_cnt += cnt;
+        if (winner == 1) {
+            win1++;
+        } else {
+            win2++;
+        }
+    }
+    rollout_count += batch_size;
+    return {1.0 * win1 / batch_size, 1.0 * win2 / batch_size, avg_cnt / batch_size};
+}
+
+// 带置信区间的胜率估计
+struct WinRateEstimate {
+    double p1;        // A 赢下本局的概率
+    double p2;        // B 赢下本局的概率
+    double avg_cnt;   // 本局剩余分数的期望
+    double se;        // p1 的标准误
+    double ci_low;    // p1 的 95% 置信区间（Wilson）
+    double ci_high;
+    int samples;      // 实际模拟次数
+};
@@ -0,0 +1,719 @@
+// model_0_4 的分析流程：逐分重放（默认、推测并行、模拟预算）、可修改的增量分析、批量分析和实时模式
+#pragma once
+
+#include <cctype>
+#include <climits>
+#include <deque>
+#include <future>
+#include <numeric>
+
+#include "model_0_4_options.hpp"
+
+// 记录一分：写入历史、更新势能窗口，result 非空时追加一行结果（比分为这一分之后的比分，
+// games_a:games_b 为本局之前的局分）
+inline void recordPoint(MatchContext& ctx, MomentumWindow& live, int game_idx, char winner, const PointLeverage& lev,
+                 int point_no, int scrA, int scrB, int games_a, int games_b, MatchResult* result) {
+    double L = lev.L;
+    double ga = (winner == playerA.id) ? L : 0.0;
+    double gb = (winner == playerB.id) ? -L : 0.0;
+    live.push(ga, gb, game_idx);
+    live.update_momentum(game_idx);
+    ctx.all_points.emplace_back(ga, gb, live.M_A, live.M_B, game_idx);
+    ctx.touch();
+    if (!result) return;
+
+    // 更新球员势头和ELO
+    double M_A = live.M_A;
+    double M_B = live.M_B;
+    double delta_M_A = M_B - M_A;
+    double delta_M_B = M_A - M_B;
+    result->point.push_back(point_no);
+    result->game.push_back(game_idx + 1);
+    result->score_a.push_back(scrA);
+    result->score_b.push_back(scrB);
+    result->L.push_back(L);
+    result->G_A.push_back(ga);
+    result->G_B.push_back(gb);
+    result->M_A.push_back(M_A);
+    result->M_B.push_back(M_B);
+    result->elo_A.push_back(calculateEloRating(playerA, M_A, delta_M_A));
+    result->elo_B.push_back(calculateEloRating(playerB, M_B, delta_M_B));
+    if (best_of > 0) {
+        const MatchOdds& odds = matchOdds();
+        double p_game = winner == playerA.id ? lev.rtwp_win : lev.rtwp_lose;
+        result->P_match.push_back(odds.matchProb(games_a, games_b, p_game));
+        result->L_match.push_back(odds.matchProb(games_a, games_b, lev.rtwp_win) -
+                                  odds.matchProb(games_a, games_b, lev.rtwp_lose));
+    }
+    if (lev.se >= 0) result->L_se.push_back(lev.se);
+    if (lev.ci >= 0) result->L_ci.push_back(lev.ci);
+}
+
+// 两个模拟输入窗口是否在 tol 内一致：同样的分（局相同，G 相差不超过 tol）和末尾势能。
+// 模拟只从这些量出发（窗口内的加权和由 windowAt 重新累加），tol = 0 时结果逐位相同
+inline bool closeWindow(const MomentumWindow& a, const MomentumWindow& b, double tol) {
+    if (a.count != b.count || a.ref_game != b.ref_game) return false;
+    for (int k = 0; k < a.count; k++) {
+        const MomentumWindow::Entry &x = a.at(k), &y = b.at(k);
+        if (x.game_idx != y.game_idx || std::abs(x.G_A - y.G_A) > tol || std::abs(x.G_B - y.G_B) > tol) return false;
+    }
+    return std::abs(a.M_A - b.M_A) <= tol && std::abs(a.M_B - b.M_B) <= tol;
+}
+
+struct SpeculationStats {
+    std::atomic<long long> points{0}, rounds{0}, evaluations{0};
+};
+inline SpeculationStats spec_stats;
+
+// 推测并行地逐分分析：第 i 分的 L 只取决于它之前 WINDOW_SIZE 分的 G 和末尾势能，而这些对更早的 L 不敏感。
+// 已确定的分（frontier 之前）之后，按各分最近一次的 L（没算过的按 0）推出 [frontier, frontier + spec_width)
+// 每一分的模拟输入，输入与上次计算时相差超过 spec_tol 的分在 spec_pool 上同时重算；
+// 然后从 frontier 起按真实历史逐分核对，上次计算的输入与之相差不超过 spec_tol 的分依次确定，遇到不符即停。
+// frontier 处的输入总是准确的，每轮至少确定一分。每一分用自己的分序号取随机数流，结果与线程数无关
+inline int analyseMatchSpeculative(MatchContext& ctx, const MatchRecord& match, MatchResult* result) {
+    struct Point {
+        char winner;
+        int game_idx, scr_a, scr_b, games_a, games_b;  // 这一分之前的局内比分和局分
+    };
+    std::vector<Point> points;
+    int games_a = 0, games_b = 0;
+    for (int g = 0; g < match.games(); g++) {
+        int scr_a = 0, scr_b = 0;
+        for (char winner : match.game(g)) {
+            points.push_back({winner, g, scr_a, scr_b, games_a, games_b});
+            (winner == playerA.id ? scr_a : scr_b)++;
+        }
+        if (!match.game(g).empty()) (scr_a > scr_b ? games_a : games_b)++;
+    }
+    int n = points.size();
+    std::vector<PointLeverage> lev(n);
+    std::vector<MomentumWindow> used(n);  // 每一分上次计算时的模拟输入
+    std::vector<char> evaluated(n, 0);
+
+    MomentumWindow live;
+    int frontier = 0, rounds = 0, evaluations = 0;
+    while (frontier < n) {
+        int end = std::min(n, frontier + spec_width);
+        // 估计的历史：已确定部分的最后 WINDOW_SIZE 分，接上 [frontier, end) 按当前估计推出的分
+        MatchContext est;
+        size_t base = ctx.all_points.size() - std::min(ctx.all_points.size(), (size_t)WINDOW_SIZE);
+        est.all_points.assign(ctx.all_points.begin() + base, ctx.all_points.end());
+        MomentumWindow w = live;
+        std::vector<int> todo;
+        std::vector<MomentumWindow> inputs(end - frontier);
+        double guess = frontier > 0 ? lev[frontier - 1].L : 0.0;
+        for (int i = frontier; i < end; i++) {
+            const Point& p = points[i];
+            inputs[i - frontier] = windowAt(est, est.all_points.size(), p.game_idx);
+            if (!evaluated[i] || !closeWindow(used[i], inputs[i - frontier], spec_tol)) todo.push_back(i);
+            // 没算过的分先借用前一分的估计
+            double L = evaluated[i] ? lev[i].L : guess;
+            guess = L;
+            double ga = p.winner == playerA.id ? L : 0.0;
+            double gb = p.winner == playerB.id ? -L : 0.0;
+            w.push(ga, gb, p.game_idx);
+            w.update_momentum(p.game_idx);
+            est.all_points.emplace_back(ga, gb, w.M_A, w.M_B, p.game_idx);
+        }
+
+        std::function<void(int)> task = [&](int t) {
+            int i = todo[t];
+            size_t at = std::min(ctx.all_points.size(), (size_t)WINDOW_SIZE) + (i - frontier);
+            MatchContext local;
+            local.match = ctx.match;
+            local.all_points.assign(est.all_points.begin() + (at - std::min(at, (size_t)WINDOW_SIZE)),
+                                    est.all_points.begin() + at);
+            local.point_key = i;
+            local.touch();
+            lev[i] = point_leverage(local, points[i].scr_a, points[i].scr_b, points[i].game_idx);
+            used[i] = inputs[i - frontier];
+            evaluated[i] = 1;
+        };
+        if (spec_pool) spec_pool->parallel_for(todo.size(), task);
+        else for (size_t t = 0; t < todo.size(); t++) task(t);
+        rounds++, evaluations += todo.size();
+
+        for (; frontier < end; frontier++) {
+            const Point& p = points[frontier];
+            if (!evaluated[frontier] || !closeWindow(used[frontier], get_sim_window(ctx, p.game_idx), spec_tol)) break;
+            int scr_a = p.scr_a + (p.winner == playerA.id), scr_b = p.scr_b + (p.winner == playerB.id);
+            recordPoint(ctx, live, p.game_idx, p.winner, lev[frontier], frontier + 1, scr_a, scr_b, p.games_a,
+                        p.games_b, result);
+        }
+    }
+    spec_stats.points += n, spec_stats.rounds += rounds, spec_stats.evaluations += evaluations;
+    return n;
+}
+
+// 配对估计 L 的累计量：三个比分的第 k 次模拟都用第 k 条流（与 winningRateMonteCarlo 相同，
+// 第 0 ~ 9999 条流给出的 L 与默认结果一致），赢下 / 输掉这一分两个比分的胜负之差 D_k 的样本方差给出 L 的标准误
+struct LeverageSums {
+    long long n = 0, win = 0, lose = 0, dd = 0;
+    double cnt = 0;
+
+    // 追加第 [begin, end) 条流的模拟，按 MC_CHUNK_SIZE 分块，有线程池时并行
+    void add(const MatchContext& ctx, int scr1, int scr2, int game_idx, long long begin, long long end) {
+        if (end <= begin) return;
+        MomentumWindow seed = get_sim_window(ctx, game_idx);
+        int chunks = (end - begin + MC_CHUNK_SIZE - 1) / MC_CHUNK_SIZE;
+        std::vector<LeverageSums> chunk_sums(chunks);
+        std::function<void(int)> run_chunk = [&](int c) {
+            LeverageSums& s = chunk_sums[c];
+            for (long long k = begin + (long long)c * MC_CHUNK_SIZE; k < std::min(end, begin + (c + 1LL) * MC_CHUNK_SIZE); k++) {
+                PhiloxStream rng_win = ctx.rolloutStream(k), rng_lose = rng_win, rng_now = rng_win;
+                int w = std::get<0>(simulateGame(seed, scr1 + 1, scr2, game_idx, rng_win)) == 1;
+                int l = std::get<0>(simulateGame(seed, scr1, scr2 + 1, game_idx, rng_lose)) == 1;
+                s.win += w, s.lose += l, s.dd += (w - l) * (w - l);
+                s.cnt += std::get<1>(simulateGame(seed, scr1, scr2, game_idx, rng_now));
+            }
+        };
+        if (pool) pool->parallel_for(chunks, run_chunk);
+        else for (int c = 0; c < chunks; c++) run_chunk(c);
+        for (const LeverageSums& s : chunk_sums) win += s.win, lose += s.lose, dd += s.dd, cnt += s.cnt;
+        n += end - begin;
+        rollout_count += 3LL * (end - begin);
+    }
+
+    // 单次模拟对 L 的标准差 weight(cnt) * sd(D)（剩余分数的误差忽略）。不考虑封顶：试算时封顶的分之后未必封顶
+    double unitSd() const {
+        double mean_d = 1.0 * (win - lose) / n;
+        double var_d = std::max(0.0, 1.0 * dd / n - mean_d * mean_d);
+        if (var_d == 0) {
+            // 样本全相同时与 winningRateAdaptive 一样改用 (win + 2) / (n + 4)，不把误差估成 0
+            double pw = (win + 2.0) / (n + 4.0), pl = (lose + 2.0) / (n + 4.0);
+            var_d = pw * (1 - pw) + pl * (1 - pl);
+        }
+        return Core::Leverage::weight(cnt / n) * std::sqrt(var_d);
+    }
+
+    // 分配用的标准差：比封顶高出 3 个标准误以上时再模拟也不会改变 L，记 0
+    double allocationSd() const {
+        double mean_d = 1.0 * (win - lose) / n, unit_sd = unitSd();
+        double over_cap = mean_d * Core::Leverage::weight(cnt / n) - Core::leverage(1.0 * win / n, 1.0 * lose / n, cnt / n);
+        return over_cap > 3 * unit_sd / std::sqrt(n) ? 0.0 : unit_sd;
+    }
+
+    // 封顶时 L 不随胜率变化，标准误记 0
+    PointLeverage result() const {
+        double rtwp_win = 1.0 * win / n, rtwp_lose = 1.0 * lose / n;
+        double L = Core::leverage(rtwp_win, rtwp_lose, cnt / n);
+        bool capped = (rtwp_win - rtwp_lose) * Core::Leverage::weight(cnt / n) > L;
+        return {L, rtwp_win, rtwp_lose, capped ? 0.0 : unitSd() / std::sqrt(n)};
+    }
+};
+
+// 按 analyseMatch 的顺序逐分分析，第 k 分（0 开始）的杠杆由 leverage(ctx, scrA, scrB, game_idx, k) 给出。返回总分数
+template <class F>
+int replayPoints(MatchContext& ctx, const MatchRecord& match, MatchResult* result, F leverage) {
+    ctx.all_points.clear();
+    ctx.touch();
+    if (result) result->clear();
+    int total_point = 0;
+
+    MomentumWindow live;  // 真实比赛的势能窗口，与模拟共用增量更新
+    int games_a = 0, games_b = 0;
+    for (int game_idx = 0; game_idx < match.games(); ++game_idx) {
+        std::string_view seq = match.game(game_idx);
+        int scrA = 0, scrB = 0;
+
+        for (char winner : seq) {
+            PointLeverage lev = leverage(ctx, scrA, scrB, game_idx, total_point);
+            // 更新比分
+            if (winner == playerA.id) scrA++;
+            else scrB++;
+            total_point++;
+            recordPoint(ctx, live, game_idx, winner, lev, total_point, scrA, scrB, games_a, games_b, result);
+        }
+        if (!seq.empty()) (scrA > scrB ? games_a : games_b)++;
+    }
+    return total_point;
+}
+
+struct BudgetStats {
+    long long matches = 0, requested = 0, used = 0;
+    long long min_rollouts = LLONG_MAX, max_rollouts = 0;
+    long long short_matches = 0;  // 预算不够每分 ADAPTIVE_BLOCK 次、只能超支的比赛数
+
+    void add(long long budget, long long rollouts, const std::vector<long long>& n, bool short_budget) {
+        std::lock_guard<std::mutex> lock(mtx);
+        matches++, requested += budget, used += rollouts, short_matches += short_budget;
+        for (long long x : n) min_rollouts = std::min(min_rollouts, x), max_rollouts = std::max(max_rollouts, x);
+    }
+
+private:
+    std::mutex mtx;
+};
+inline BudgetStats budget_stats;
+
+// 在全场预算内逐分分配模拟次数（只需一遍：L_i 定下后才能模拟下一分，历史随之改变）。
+// 每分先跑 pilot 次得到单次模拟对 L 的标准差 s_i，再按 Neyman 分配 n_i ∝ sqrt(v_i) * s_i 补足，
+// 使 sum v_i * s_i^2 / n_i 在 sum n_i 固定时最小；之后各分的 s_j 未知，用已算各分的平均值代替。
+// v_i 为 1（--budget-objective=leverage），或 L_i 在之后 WINDOW_SIZE 分势能中的系数平方和（momentum）：
+// 第 j 分的势能是窗口内 G 的加权平均，G_i 的系数为 decay[i 与 j 的局关系][j - i] / 第 j 分窗口的权重和
+inline int analyseMatchBudgeted(MatchContext& ctx, const MatchRecord& match, MatchResult* result) {
+    int n_points = match.points.size();
+    std::vector<int> game;
+    for (int g = 0; g < match.games(); g++) game.insert(game.end(), match.game(g).size(), g);
+    std::vector<double> importance(n_points, 1.0);  // sqrt(v_i)
+    if (budget_objective == BudgetObjective::Momentum) {
+        for (int i = 0; i < n_points; i++) {
+            double v = 0;
+            for (int j = i; j < std::min(n_points, i + WINDOW_SIZE); j++) {
+                double den = 0;
+                for (int k = std::max(0, j - WINDOW_SIZE + 1); k <= j; k++)
+                    den += Core::decay_table[Core::Decay::pick(game[k], game[j])][j - k];
+                double coef = Core::decay_table[Core::Decay::pick(game[i], game[j])][j - i] / den;
+                v += coef * coef;
+            }
+            importance[i] = std::sqrt(v);
+        }
+    }
+    std::vector<double> importance_after(n_points + 1, 0.0);  // sum_{j >= i} sqrt(v_j)
+    for (int i = n_points - 1; i >= 0; i--) importance_after[i] = importance_after[i + 1] + importance[i];
+
+    // 每个比分还可用的模拟次数。每分至少试算 ADAPTIVE_BLOCK 次，预算不够时按这个下限超支，结束时提示；
+    // 随机数流序号为 32 位，每分最多 UINT32_MAX 次
+    long long left = rollout_budget / 3;
+    bool short_budget = left < (long long)ADAPTIVE_BLOCK * n_points;
+    long long pilot = std::max<long long>(ADAPTIVE_BLOCK, n_points ? left / n_points / 5 : 0);
+    pilot = std::min<long long>(pilot, UINT32_MAX);
+    double sd_sum = 0;
+    std::vector<long long> n(n_points);
+    int total_point = replayPoints(ctx, match, result, [&](const MatchContext& c, int a, int b, int g, int k) {
+        LeverageSums sums;
+        sums.add(c, a, b, g, 0, pilot);
+        double s = sums.allocationSd();
+        sd_sum += s;
+        double share = importance[k] * s, later = importance_after[k + 1] * sd_sum / (k + 1);
+        long long spare = std::max(0LL, left - (long long)pilot * (n_points - k));  // 给之后每分留出 pilot 次
+        long long extra = share + later > 0 ? (long long)(spare * (share / (share + later))) : 0;
+        n[k] = std::min<long long>(pilot + extra, UINT32_MAX);
+        sums.add(c, a, b, g, pilot, n[k]);
+        left -= n[k];
+        return sums.result();
+    });
+    budget_stats.add(rollout_budget, 3LL * std::accumulate(n.begin(), n.end(), 0LL), n, short_budget);
+    return total_point;
+}
+
+// 逐分分析一场比赛：清空历史后依次计算每一分的 L_i、势能和 elo，result 非空时记录结果。返回总分数
+inline int analyseMatch(MatchContext& ctx, const MatchRecord& match, MatchResult* result) {
+    if (rollout_budget > 0 && solver_mode == SolverMode::MonteCarlo) return analyseMatchBudgeted(ctx, match, result);
+    if (spec_width > 0 && !batch_mode) {
+        ctx.all_points.clear();
+        ctx.touch();
+        if (result) result->clear();
+        return analyseMatchSpeculative(ctx, match, result);
+    }
+    return replayPoints(ctx, match, result, [](const MatchContext& c, int a, int b, int g, int) {
+        return point_leverage(c, a, b, g);
+    });
+}
+
+// 两个势能窗口的内容和加权和是否逐位相同（环形缓冲的起点可以不同）
+inline bool sameWindow(const MomentumWindow& a, const MomentumWindow& b) {
+    return a.identical(b);
+}
+
+// 可修改的比赛分析：记录每一分之前的状态，改正或插入一分后只重算受影响的后续分。
+// 第 j 分的 L 只取决于它之前的势能窗口、局内比分、局和随机数流，
+// 重算到某一分时这些与修改前逐位相同，后面的结果就不会再变，直接沿用旧结果。
+// 每一分有固定的随机数流序号（初始为下标，插入的分取新序号），插入后后续分的随机数不变，才有可能收敛。
+// 局的划分不随修改改变：插入的分属于它后面那一分所在的局（插在末尾则属于最后一局）
+class IncrementalMatch {
+public:
+    bool stop_on_converge = true;  // false 时每次修改都从第一分重算整场（用于核对）
+
+    IncrementalMatch(const MatchRecord& match, int match_idx) {
+        ctx.match = match_idx;
+        for (int g = 0; g < match.games(); g++) {
+            for (char winner : match.game(g)) points.push_back({winner, g, next_key++, {}, 0, 0, 0, 0});
+        }
+        recompute(0, 0);
+    }
+
+    const MatchResult& result() const { return res; }
+    size_t size() const { return points.size(); }
+
+    // 把第 i 分（0 开始）的得分方改为 winner，返回重算的分数；i 越界时返回 -1
+    int amend(size_t i, char winner) {
+        if (i >= points.size()) return -1;
+        if (points[i].winner == winner) return 0;
+        points[i].winner = winner;
+        return recompute(stop_on_converge ? i : 0, 0);
+    }
+
+    // 在第 i 分之前插入一分（i == size() 时接在最后），返回重算的分数；i 越界时返回 -1
+    int insert(size_t i, char winner) {
+        if (i > points.size()) return -1;
+        int game = i < points.size() ? points[i].game_idx : points.empty() ? 0 : points.back().game_idx;
+        Point p{winner, game, next_key++, tail, tail_a, tail_b, tail_games_a, tail_games_b};
+        if (i < points.size()) {
+            const Point& next = points[i];
+            p.before = next.before, p.scr_a = next.scr_a, p.scr_b = next.scr_b;
+            p.games_a = next.games_a, p.games_b = next.games_b;
+        }
+        points.insert(points.begin() + i, p);
+        return recompute(stop_on_converge ? i : 0, 1);
+    }
+
+private:
+    struct Point {
+        char winner;
+        int game_idx;
+        uint32_t key;              // 随机数流序号
+        MomentumWindow before;     // 这一分之前的势能窗口
+        int scr_a, scr_b;          // 这一分之前的局内比分
+        int games_a, games_b;      // 本局之前的局分
+    };
+
+    MatchContext ctx;
+    std::vector<Point> points;
+    MatchResult res;
+    uint32_t next_key = 0;
+    MomentumWindow tail;          // 最后一分之后的势能窗口、局内比分和局分
+    int tail_a = 0, tail_b = 0;
+    int tail_games_a = 0, tail_games_b = 0;
+
+    // 从第 from 分开始重算，points[from].before 须已是第 from 分之前的状态；
+    // from 之后的旧结果整体后移了 shift 个位置。返回重算的分数
+    int recompute(size_t from, size_t shift) {
+        MatchResult old;
+        std::swap(old, res);
+        copyRows(res, old, 0, from, 0);
+        std::vector<PointInfo> old_points(ctx.all_points.begin() + from, ctx.all_points.end());
+        ctx.all_points.erase(ctx.all_points.begin() + from, ctx.all_points.end());
+        ctx.touch();
+
+        MomentumWindow live;
+        int scr_a = 0, scr_b = 0, games_a = 0, games_b = 0;
+        if (from < points.size()) {
+            const Point& p = points[from];
+            live = p.before, scr_a = p.scr_a, scr_b = p.scr_b, games_a = p.games_a, games_b = p.games_b;
+        }
+        size_t j = from;
+        int recomputed = 0;
+        for (; j < points.size(); j++) {
+            Point& p = points[j];
+            // from 处的比分和局分已从 points[from] 读入，换局只在之后的分上计
+            if (j > from && p.game_idx != points[j - 1].game_idx) {
+                (scr_a > scr_b ? games_a : games_b)++;
+                scr_a = scr_b = 0;
+            }
+            // 这一分之前的状态与修改前相同：之后的分全部沿用（比赛层面的结果还取决于局分）
+            if (stop_on_converge && j > from && sameWindow(live, p.before) && scr_a == p.scr_a && scr_b == p.scr_b &&
+                (best_of == 0 || (games_a == p.games_a && games_b == p.games_b)))
+                break;
+            p.before = live, p.scr_a = scr_a, p.scr_b = scr_b, p.games_a = games_a, p.games_b = games_b;
+            ctx.point_key = p.key;
+            PointLeverage lev = point_leverage(ctx, scr_a, scr_b, p.game_idx);
+            if (p.winner == playerA.id) scr_a++;
+            else scr_b++;
+            recordPoint(ctx, live, p.game_idx, p.winner, lev, j + 1, scr_a, scr_b, games_a, games_b, &res);
+            recomputed++;
+        }
+        if (j == points.size()) {
+            tail = live, tail_a = scr_a, tail_b = scr_b, tail_games_a = games_a, tail_games_b = games_b;
+        } else {
+            size_t old_j = j - shift;
+            ctx.all_points.insert(ctx.all_points.end(), old_points.begin() + (old_j - from), old_points.end());
+            copyRows(res, old, old_j, old.size(), (int)shift);
+        }
+        ctx.point_key = UINT32_MAX;
+        ctx.touch();
+        return recomputed;
+    }
+
+    // 把 from 的 [begin, end) 行追加到 to，分序号加 shift
+    static void copyRows(MatchResult& to, const MatchResult& from, size_t begin, size_t end, int shift) {
+        for (size_t i = begin; i < end; i++) {
+            to.point.push_back(from.point[i] + shift);
+            to.game.push_back(from.game[i]);
+            to.score_a.push_back(from.score_a[i]);
+            to.score_b.push_back(from.score_b[i]);
+            to.L.push_back(from.L[i]);
+            to.G_A.push_back(from.G_A[i]);
+            to.G_B.push_back(from.G_B[i]);
+            to.M_A.push_back(from.M_A[i]);
+            to.M_B.push_back(from.M_B[i]);
+            to.elo_A.push_back(from.elo_A[i]);
+            to.elo_B.push_back(from.elo_B[i]);
+            if (!from.P_match.empty()) to.P_match.push_back(from.P_match[i]), to.L_match.push_back(from.L_match[i]);
+            if (!from.L_se.empty()) to.L_se.push_back(from.L_se[i]);
+            if (!from.L_ci.empty()) to.L_ci.push_back(from.L_ci[i]);
+        }
+    }
+};
+
+struct BatchStats {
+    int matches = 0;
+    long long points = 0;
+    double seconds = 0;
+};
+
+// 批量分析：每个线程一个任务队列，比赛按分数从多到少轮流分给各队列，长比赛先开始；
+// 线程从自己队列的头部取任务，自己的空了就从别的队列尾部偷短比赛，不会有线程空等长比赛。
+// 第 i 场比赛的随机数流编号为 first_match + i，结果与顺序分析相同；
+// 需要输出时各场结果先暂存，按输入顺序写入文本 / 二进制结果
+inline BatchStats analyseBatch(const std::vector<MatchRecord>& matches, int threads, TableWriter* out,
+                        ResultWriter* writer = nullptr, int first_match = 0) {
+    struct WorkQueue {
+        std::mutex mtx;
+        std::deque<int> tasks;
+    };
+    int n = matches.size();
+    threads = std::max(1, std::min(threads, n));
+    std::vector<WorkQueue> queues(threads);
+    std::vector<int> order(n);
+    for (int i = 0; i < n; i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return matches[a].points.size() > matches[b].points.size();
+    });
+    for (int k = 0; k < n; k++) queues[k % threads].tasks.push_back(order[k]);
+
+    bool keep = out || writer;
+    std::vector<MatchResult> results(keep ? n : 0);
+    std::vector<char> ready(n, 0);
+    std::mutex out_mtx;
+    int next_out = 0;
+    std::atomic<long long> points{0};
+
+    auto take = [&](int self, int& task) {
+        {
+            std::lock_guard<std::mutex> lock(queues[self].mtx);
+            if (!queues[self].tasks.empty()) {
+                task = queues[self].tasks.front();
+                queues[self].tasks.pop_front();
+                return true;
+            }
+        }
+        for (int k = 1; k < threads; k++) {
+            WorkQueue& victim = queues[(self + k) % threads];
+            std::lock_guard<std::mutex> lock(victim.mtx);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.back();
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    };
+
+    auto worker = [&](int self) {
+        MatchContext ctx;  // 每个线程复用一个上下文
+        int task;
+        while (take(self, task)) {
+            ctx.match = first_match + task;
+            if (!keep) {
+                points += analyseMatch(ctx, matches[task], nullptr);
+                continue;
+            }
+            MatchResult result;
+            points += analyseMatch(ctx, matches[task], &result);
+            std::lock_guard<std::mutex> lock(out_mtx);
+            results[task] = std::move(result);
+            ready[task] = 1;
+            for (; next_out < n && ready[next_out]; next_out++) {
+                if (out) printMatch(*out, matches[next_out], results[next_out]);
+                if (writer) writer->add(matches[next_out], results[next_out]);
+                results[next_out] = MatchResult();
+            }
+        }
+    };
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; t++) workers.emplace_back(worker, t);
+    worker(0);
+    for (auto& t : workers) t.join();
+    BatchStats stats;
+    stats.matches = n;
+    stats.points = points;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return stats;
+}
+
+/******************************live mode*************************************/
+
+// 实时模式：从标准输入逐行读入每一分的得分方（1/2 或 H/F，# 开头的行忽略），每分立即输出一行结果。
+// 一局结束（isGameOver）后自动进入下一局。
+// 延迟预算：从读到一分到输出该分结果，p99 不超过 LIVE_P99_BUDGET_US。
+// 一分的 L_i 只依赖这一分之前的历史，所以它在上一分到达时就已在后台开始计算；
+// 同时还会推测下一分两种结果各自之后的 L，输出本身只剩 O(1) 的势能和 elo 更新。
+// 每到一分后台要算两个推测分支，相邻两分的间隔不短于两次 calc_leverage
+// （单次约为：默认蒙特卡洛 20ms，--simd=auto 5ms，--exact 1ms）时预算即可满足；
+// 来得更快时需要等后台算完，结束时在 stderr 报告延迟分布。第一分到达前需要先算出开局的杠杆
+const double LIVE_P99_BUDGET_US = 1000;
+
+// 实时比赛的状态：历史、势能窗口、当前比分和局
+struct LiveState {
+    MatchContext ctx;
+    MomentumWindow window;
+    int scr_a = 0, scr_b = 0, game_idx = 0, points = 0;
+    int games_a = 0, games_b = 0;
+
+    // 下一分的杠杆
+    PointLeverage leverage() const { return point_leverage(ctx, scr_a, scr_b, game_idx); }
+
+    // 推测分支用的副本：模拟只读最后 WINDOW_SIZE 分，历史只复制这些；
+    // 分序号固定为完整历史的长度，随机数流与在完整历史上计算时相同
+    LiveState branch() const {
+        LiveState s;
+        size_t n = ctx.all_points.size();
+        s.ctx.match = ctx.match;
+        s.ctx.all_points.assign(ctx.all_points.begin() + (n - std::min(n, (size_t)WINDOW_SIZE)), ctx.all_points.end());
+        s.ctx.point_key = ctx.pointKey();
+        s.window = window;
+        s.scr_a = scr_a, s.scr_b = scr_b, s.game_idx = game_idx, s.points = points;
+        s.games_a = games_a, s.games_b = games_b;
+        return s;
+    }
+
+    void apply(char winner, const PointLeverage& lev, MatchResult* result) {
+        if (winner == playerA.id) scr_a++;
+        else scr_b++;
+        points++;
+        recordPoint(ctx, window, game_idx, winner, lev, points, scr_a, scr_b, games_a, games_b, result);
+        if (int over = isGameOver(scr_a, scr_b)) {
+            (over == 1 ? games_a : games_b)++;
+            game_idx++, scr_a = scr_b = 0;
+        }
+    }
+};
+
+class LiveMatch {
+public:
+    LiveMatch() : worker([this] { work(); }) {
+        LiveState snapshot = state;
+        next = spawn([snapshot] { return snapshot.leverage(); }, nullptr);
+        speculate();
+    }
+
+    ~LiveMatch() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        worker.join();
+    }
+
+    // 处理一分，结果追加到 result；返回是否需要等待后台计算
+    bool play(char winner, MatchResult& result) {
+        bool waited = next.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+        state.apply(winner, next.get(), &result);
+        int w = winner == playerA.id ? 0 : 1;
+        next = spec[w];
+        *spec_cancel[1 - w] = true;
+        speculate();
+        return waited;
+    }
+
+private:
+    using Leverage = std::shared_future<PointLeverage>;
+    using Cancel = std::shared_ptr<std::atomic<bool>>;
+
+    LiveState state;
+    Leverage next;       // 当前状态下一分的杠杆
+    Leverage spec[2];    // 下一分 A / B 得分后，再下一分的杠杆
+    Cancel spec_cancel[2];
+
+    // 后台线程按提交顺序执行计算；被放弃的推测分支在开始前跳过
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<std::function<void()>> jobs;
+    bool stopping = false;
+    std::thread worker;
+
+    void work() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [&] { return stopping || !jobs.empty(); });
+                if (stopping) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+    template <class F>
+    Leverage spawn(F fn, Cancel cancel) {
+        auto task = std::make_shared<std::packaged_task<PointLeverage()>>(std::move(fn));
+        Leverage f = task->get_future().share();
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            jobs.push_back([task, cancel] {
+                if (!cancel || !*cancel) (*task)();
+            });
+        }
+        cv.notify_one();
+        return f;
+    }
+
+    // 推测下一分的两种结果：分支先等 next 算完，再以假设的这一分为历史计算下一分的杠杆。
+    // 分支的历史与真实历史的最后 WINDOW_SIZE 分逐项相同，随机数流也相同，所以推测结果与事后计算完全一致
+    void speculate() {
+        for (int w = 0; w < 2; w++) {
+            spec_cancel[w] = std::make_shared<std::atomic<bool>>(false);
+            char winner = w == 0 ? playerA.id : playerB.id;
+            spec[w] = spawn([snapshot = state.branch(), parent = next, winner]() mutable {
+                snapshot.apply(winner, parent.get(), nullptr);
+                snapshot.ctx.point_key++;
+                return snapshot.leverage();
+            }, spec_cancel[w]);
+        }
+    }
+};
+
+// 实时模式主循环，返回处理的分数
+inline int runLive(std::istream& in, std::ostream& os, ResultWriter* writer) {
+    TableWriter out(os);
+    LiveMatch match;
+    MatchResult result;
+    MatchRecord record;  // 已到达的得分序列，用于写二进制结果
+    record.id = "live";
+    std::vector<double> latency_us;
+    int waits = 0;
+    printHeader(out);
+    out.flush();
+    std::string line;
+    while (std::getline(in, line)) {
+        auto t0 = std::chrono::steady_clock::now();
+        std::string_view token(line);
+        while (!token.empty() && std::isspace((unsigned char)token.back())) token.remove_suffix(1);
+        while (!token.empty() && std::isspace((unsigned char)token.front())) token.remove_prefix(1);
+        if (token.empty() || token[0] == '#') continue;
+        char winner = parsePointWinner(token);
+        if (!winner) {
+            std::cerr << "live: unknown point winner '" << token << "', ignored\n";
+            continue;
+        }
+        waits += match.play(winner, result);
+        record.points.push_back(winner);
+        printRow(out, result, result.size() - 1);
+        out.flush();  // 每分立即送出
+        latency_us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+    }
+
+    if (!latency_us.empty()) {
+        std::sort(latency_us.begin(), latency_us.end());
+        auto pct = [&](double q) { return latency_us[std::min(latency_us.size() - 1, (size_t)(q * latency_us.size()))]; };
+        std::cerr << "live: " << latency_us.size() << " points, latency p50 " << pct(0.5) << "us, p99 " << pct(0.99)
+                  << "us, max " << latency_us.back() << "us (budget p99 " << LIVE_P99_BUDGET_US << "us), "
+                  << waits << " points waited for the background leverage\n";
+        if (pct(0.99) > LIVE_P99_BUDGET_US)
+            std::cerr << "live: p99 over budget, points arrived faster than calc_leverage\n";
+    }
+    if (writer) {
+        for (size_t i = 1; i < result.size(); i++)
+            if (result.game[i] != result.game[i - 1]) record.game_end.push_back(i);
+        if (result.size()) record.game_end.push_back(result.size());
+        writer->add(record, result);
+    }
+    return result.size();
+}
+
+/******************************live mode*************************************/
@@ -0,0 +1,1040 @@
+// model_0_4 的胜率和杠杆求解：lockstep 批量模拟、自适应与并行蒙特卡洛、方差缩减、
+// 截断历史的动态规划、胜率缓存、公共随机数的杠杆估计和比赛层面的胜率
+#pragma once
+
+#include <list>
+#include <unordered_map>
+
+#include "model_0_4_base.hpp"
+
+/******************************lockstep kernel*******************************/
+
+// 同步推进的批量模拟：LANES 条模拟的比分、势能窗口和随机数状态按结构体数组（SoA）存放，
+// 每一步对所有通道执行同样的算术，便于编译器生成 AVX2 / AVX-512 指令。
+// 某条通道打完一局后立刻换上下一次模拟，避免平分拉锯时其余通道空转。
+// 每次模拟的随机数流由 (种子, 比赛, 分, 模拟序号) 决定，结果与通道数和指令集无关。
+struct LockstepInput {
+    int scr1, scr2;
+    int batch_begin, batch_end;         // 本次负责的模拟序号区间
+    uint64_t seed;                      // 随机数种子与计数器中的比赛、分序号
+    uint32_t match, point;
+    int n_seed;                         // 历史窗口内的真实分数（<= WINDOW_SIZE），按距离从近到远存放
+    double seed_ga[WINDOW_SIZE], seed_gb[WINDOW_SIZE], seed_same[WINDOW_SIZE];
+    double seed_ma, seed_mb;
+    double a0, a_m, a_d, b0, b_m, b_d;  // elo 线性部分：sigmoid(x0 + x_m * M_self - x_d * delta_M)
+};
+
+struct LockstepOutput {
+    long long win1 = 0, cnt = 0;
+};
+
+// 只用乘加实现的 e^x（原地计算），便于向量化：e^x = (e^(x/16))^16，|x/16| <= 0.5 时 13 阶泰勒展开相对误差约 1e-13。
+// 势能模型中 sigmoid 的自变量远小于 8，超出范围时截断。
+template <class VD>
+static inline __attribute__((always_inline)) void exp_poly(VD& x) {
+    x = x < -8.0 ? -8.0 : x;
+    x = x > 8.0 ? 8.0 : x;
+    x *= 1.0 / 16;
+    VD r = 1.0 / 6227020800.0 + x * 0.0;
+    r = r * x + 1.0 / 479001600.0;
+    r = r * x + 1.0 / 39916800.0;
+    r = r * x + 1.0 / 3628800.0;
+    r = r * x + 1.0 / 362880.0;
+    r = r * x + 1.0 / 40320.0;
+    r = r * x + 1.0 / 5040.0;
+    r = r * x + 1.0 / 720.0;
+    r = r * x + 1.0 / 120.0;
+    r = r * x + 1.0 / 24.0;
+    r = r * x + 1.0 / 6.0;
+    r = r * x + 0.5;
+    r = r * x + 1.0;
+    r = r * x + 1.0;
+    r *= r, r *= r, r *= r, r *= r;
+    x = r;
+}
+
+// 向量类型与寄存器等宽（GCC 向量扩展）：超过寄存器宽度的向量会被拆成逐元素运算。
+// 每个 ISA 同时推进 LANE_GROUPS 组向量，组间没有依赖，可以互相掩盖指令延迟。
+template <int BYTES> struct LaneVec {
+    typedef double VD __attribute__((vector_size(BYTES)));
+    typedef uint64_t VU __attribute__((vector_size(BYTES)));
+    static const int WIDTH = BYTES / sizeof(double);
+};
+const int LANE_GROUPS = 2;
+
+template <int BYTES>
+static inline __attribute__((always_inline)) LockstepOutput lockstepKernel(const LockstepInput& in) {
+    using VD = typename LaneVec<BYTES>::VD;
+    using VU = typename LaneVec<BYTES>::VU;
+    const int W = LaneVec<BYTES>::WIDTH, LANES = W * LANE_GROUPS;
+    const VD zero = {}, one = zero + 1.0;
+    const VD sign = (VD)((VU)zero + 0x8000000000000000ULL);
+
+    // 窗口按距离存放：下标 0 是最近一分；valid 为 0 表示该位置还没有分
+    VD ga[WINDOW_SIZE][LANE_GROUPS], gb[WINDOW_SIZE][LANE_GROUPS];
+    VD same[WINDOW_SIZE][LANE_GROUPS], valid[WINDOW_SIZE][LANE_GROUPS];
+    VD ma[LANE_GROUPS], mb[LANE_GROUPS], s1[LANE_GROUPS], s2[LANE_GROUPS], cnt[LANE_GROUPS];
+    VU rng[LANE_GROUPS];
+    int rollout[LANES];
+    for (int g = 0; g < LANE_GROUPS; g++) {
+        for (int d = 0; d < WINDOW_SIZE; d++) ga[d][g] = gb[d][g] = same[d][g] = valid[d][g] = zero;
+        ma[g] = mb[g] = s1[g] = s2[g] = cnt[g] = zero;
+        rng[g] = (VU)zero;
+    }
+    for (int l = 0; l < LANES; l++) rollout[l] = -2;   // -2：等待换新，-1：无模拟可做
+
+    LockstepOutput out;
+    int next = in.batch_begin, active = 0;
+    while (true) {
+        // 给空闲通道换上下一次模拟
+        for (int l = 0; l < LANES; l++) {
+            if (rollout[l] != -2) continue;
+            if (next >= in.batch_end) {
+                rollout[l] = -1;
+                continue;
+            }
+            int g = l / W, k = l % W;
+            rollout[l] = next;
+            // 通道内用 SplitMix64 出数，其初始状态取自该次模拟的 Philox 计数器块
+            Philox4x32::Counter block = Philox4x32::block({0, (uint32_t)next++, in.point, in.match},
+                                                          {(uint32_t)in.seed, (uint32_t)(in.seed >> 32)});
+            rng[g][k] = (uint64_t)block[1] << 32 | block[0];
+            s1[g][k] = in.scr1, s2[g][k] = in.scr2, cnt[g][k] = 0;
+            ma[g][k] = in.seed_ma, mb[g][k] = in.seed_mb;
+            for (int d = 0; d < WINDOW_SIZE; d++) {
+                bool v = d < in.n_seed;
+                ga[d][g][k] = v ? in.seed_ga[d] : 0.0;
+                gb[d][g][k] = v ? in.seed_gb[d] : 0.0;
+                same[d][g][k] = v ? in.seed_same[d] : 0.0;
+                valid[d][g][k] = v;
+            }
+            active++;
+        }
+        if (active == 0) break;
+
+        for (int g = 0; g < LANE_GROUPS; g++) {
+            VD m1 = (VD)((VU)ma[g] & ~(VU)sign), m2 = (VD)((VU)mb[g] & ~(VU)sign);
+            VD e1 = -(in.a0 + in.a_m * m1 - in.a_d * (m2 - m1));
+            VD e2 = -(in.b0 + in.b_m * m2 - in.b_d * (m1 - m2));
+            exp_poly(e1), exp_poly(e2);
+            e1 = 1.0 / (1.0 + e1), e2 = 1.0 / (1.0 + e2);
+            VU z = (rng[g] += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            z = z ^ (z >> 31);
+            VD u = (VD)((z >> 12) | 0x3ff0000000000000ULL) - 1.0;
+            auto win = u * (e1 + e2) <= e1;
+            for (int d = WINDOW_SIZE - 1; d > 0; d--) {
+                ga[d][g] = ga[d - 1][g], gb[d][g] = gb[d - 1][g];
+                same[d][g] = same[d - 1][g], valid[d][g] = valid[d - 1][g];
+            }
+            ga[0][g] = win ? e1 : zero;
+            gb[0][g] = win ? zero : -e2;
+            same[0][g] = one, valid[0][g] = one;
+            VD num1 = zero, num2 = zero, den = zero;
+            for (int d = 0; d < WINDOW_SIZE; d++) {
+                VD w = valid[d][g] * (same[d][g] * DECAY_SAME[d] + (1.0 - same[d][g]) * DECAY_CROSS[d]);
+                num1 += ga[d][g] * w;
+                num2 += gb[d][g] * w;
+                den += w;
+            }
+            ma[g] = num1 / den, mb[g] = num2 / den;
+            s1[g] += win ? one : zero;
+            s2[g] += win ? zero : one;
+            cnt[g] += one;
+        }
+
+        // 结束判定：先整体求出结束掩码，只有结束的通道才逐个记录
+        for (int g = 0; g < LANE_GROUPS; g++) {
+            VD diff = s1[g] - s2[g];
+            auto over = ((s1[g] >= 11.0) | (s2[g] >= 11.0)) & ((diff >= 2.0) | (diff <= -2.0));
+            for (int k = 0; k < W; k++) {
+                int l = g * W + k;
+                if (!over[k] || rollout[l] < 0) continue;
+                out.win1 += diff[k] > 0;
+                out.cnt += (long long)cnt[g][k];
+                rollout[l] = -2;
+                active--;
+            }
+        }
+    }
+    return out;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LOCKSTEP_X86 1
+__attribute__((target("avx512f,avx512dq,avx512vl")))
+inline LockstepOutput lockstepAVX512(const LockstepInput& in) { return lockstepKernel<64>(in); }
+__attribute__((target("avx2")))
+inline LockstepOutput lockstepAVX2(const LockstepInput& in) { return lockstepKernel<32>(in); }
+#endif
+inline LockstepOutput lockstepGeneric(const LockstepInput& in) { return lockstepKernel<16>(in); }
+
+inline SimdLevel resolveSimdLevel(SimdLevel level) {
+#ifdef LOCKSTEP_X86
+    bool has512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl");
+    bool has2 = __builtin_cpu_supports("avx2");
+    if (level == SimdLevel::Auto) return has512 ? SimdLevel::AVX512 : has2 ? SimdLevel::AVX2 : SimdLevel::Generic;
+    if (level == SimdLevel::AVX512 && !has512) return has2 ? SimdLevel::AVX2 : SimdLevel::Generic;
+    if (level == SimdLevel::AVX2 && !has2) return SimdLevel::Generic;
+    return level;
+#else
+    return level == SimdLevel::Off ? level : SimdLevel::Generic;
+#endif
+}
+
+inline LockstepOutput runLockstep(const LockstepInput& in) {
+#ifdef LOCKSTEP_X86
+    if (simd_level == SimdLevel::AVX512) return lockstepAVX512(in);
+    if (simd_level == SimdLevel::AVX2) return lockstepAVX2(in);
+#endif
+    return lockstepGeneric(in);
+}
+
+inline std::tuple<double, double, double> winningRateLockstep(const MatchContext& ctx, int scr1, int scr2, int game_idx) {
+    int batch_size = 10000;
+    int over = isGameOver(scr1, scr2);
+    if (over) return {over == 1 ? 1.0 : 0.0, over == 2 ? 1.0 : 0.0, 0.0};
+
+    LockstepInput in{};
+    in.scr1 = scr1, in.scr2 = scr2;
+    in.seed = rng_seed, in.match = ctx.match, in.point = ctx.pointKey();
+    MomentumWindow seed = get_sim_window(ctx, game_idx);
+    in.n_seed = seed.count;
+    for (int d = 0; d < in.n_seed; d++) {
+        const MomentumWindow::Entry& e = seed.at(seed.count - 1 - d);
+        in.seed_ga[d] = e.G_A, in.seed_gb[d] = e.G_B;
+        in.seed_same[d] = e.game_idx == game_idx;
+    }
+    in.seed_ma = seed.M_A, in.seed_mb = seed.M_B;
+    using W = Core::Elo;
+    in.a0 = playerA.cap * W::w_cap * playerA.sta, in.a_m = W::w_M * playerA.sta, in.a_d = W::w_delta_M * (1 - playerA.psy) * playerA.sta;
+    in.b0 = playerB.cap * W::w_cap * playerB.sta, in.b_m = W::w_M * playerB.sta, in.b_d = W::w_delta_M * (1 - playerB.psy) * playerB.sta;
+
+    long long win1 = 0, cnt = 0;
+    if (pool) {
+        int chunks = (batch_size + MC_CHUNK_SIZE - 1) / MC_CHUNK_SIZE;
+        std::vector<LockstepOutput> outs(chunks);
+        pool->parallel_for(chunks, [&](int c) {
+            LockstepInput chunk = in;
+            chunk.batch_begin = c * MC_CHUNK_SIZE;
+            chunk.batch_end = std::min(batch_size, chunk.batch_begin + MC_CHUNK_SIZE);
+            outs[c] = runLockstep(chunk);
+        });
+        for (auto& o : outs) win1 += o.win1, cnt += o.cnt;
+    } else {
+        in.batch_begin = 0, in.batch_end = batch_size;
+        LockstepOutput o = runLockstep(in);
+        win1 = o.win1, cnt = o.cnt;
+    }
+    rollout_count += batch_size;
+    return {1.0 * win1 / batch_size, 1.0 * (batch_size - win1) / batch_size, 1.0 * cnt / batch_size};
+}
+
+/******************************lockstep kernel*******************************/
+
+// 自适应蒙特卡洛：悬殊比分很快收敛，接近的比分才用满预算
+inline WinRateEstimate winningRateAdaptive(const MatchContext& ctx, int scr1, int scr2, int game_idx) {
+    const double z = 1.96;
+    int win1 = 0, n = 0;
+    double avg_cnt = 0, se = 0;
+    MomentumWindow seed = get_sim_window(ctx, game_idx);
+    while (n < max_batch) {
+        int block = std::min(ADAPTIVE_BLOCK, max_batch - n);
+        for (int i = n; i < n + block; i++) {
+            PhiloxStream rng = ctx.rolloutStream(i);
+            auto [winner, cnt] = simulateGame(seed, scr1, scr2, game_idx, rng);
+            avg_cnt += cnt;
+            win1 += winner == 1;
+        }
+        n += block;
+        // 用 (win + 2) / (n + 4) 估计方差，避免 0 或 1 时标准误为 0 而过早停止
+        double p_adj = (win1 + 2.0) / (n + 4.0);
+        se = std::sqrt(p_adj * (1 - p_adj) / n);
+        if (n >= MIN_BATCH && se <= target_se) break;
+    }
+    rollout_count += n;
+    double p = 1.0 * win1 / n;
+    double denom = 1 + z * z / n;
+    double center = (p + z * z / (2.0 * n)) / denom;
+    double half = z * std::sqrt(p * (1 - p) / n + z * z / (4.0 * n * n)) / denom;
+    return {p, 1 - p, avg_cnt / n, se, center - half, center + half, n};
+}
+
+// 并行蒙特卡洛：模拟按 MC_CHUNK_SIZE 分块交给线程池，每次模拟使用自己的计数器随机数流，
+// 各块结果按块号顺序合并，因此结果与线程数无关，也与单线程版本相同
+inline std::tuple<double, double, double> winningRateParallel(const MatchContext& ctx, int scr1, int scr2, int game_idx) {
+    int batch_size = 10000;
+    int chunks = (batch_size + MC_CHUNK_SIZE - 1) / MC_CHUNK_SIZE;
+    MomentumWindow seed = get_sim_window(ctx, game_idx);
+    std::vector<int> chunk_win1(chunks), chunk_win2(chunks);
+    std::vector<long long> chunk_cnt(chunks);
+    pool->parallel_for(chunks, [&](int c) {
+        int begin = c * MC_CHUNK_SIZE, end = std::min(batch_size, begin + MC_CHUNK_SIZE);
+        for (int i = begin; i < end; i++) {
+            PhiloxStream rng = ctx.rolloutStream(i);
+            auto [winner, cnt] = simulateGame(seed, scr1, scr2, game_idx, rng);
+            chunk_cnt[c] += cnt;
+            if (winner == 1) chunk_win1[c]++;
+            else chunk_win2[c]++;
+        }
+    });
+    int win1 = 0, win2 = 0;
+    double avg_cnt = 0;
+    for (int c = 0; c < chunks; c++) {
+        win1 += chunk_win1[c];
+        win2 += chunk_win2[c];
+        avg_cnt += chunk_cnt[c];
+    }
+    rollout_count += batch_size;
+    return {1.0 * win1 / batch_size, 1.0 * win2 / batch_size, avg_cnt / batch_size};
+}
+
+/******************************variance reduction****************************/
+
+// 对偶随机数流：输出按位取反，均匀分布 u 变为 1 - u（相差 2^-64），骰子落在另一侧
+template <class Stream>
+class MirroredStream {
+public:
+    using result_type = typename Stream::result_type;
+    static constexpr result_type min() { return Stream::min(); }
+    static constexpr result_type max() { return Stream::max(); }
+
+    explicit MirroredStream(Stream s) : stream(s) {}
+    result_type operator()() { return ~stream(); }
+
+private:
+    Stream stream;
+};
+
+// 秩 1 格点 {i * z / n} 的 Korobov 生成向量 z_j = a^j mod n。a 取 [1, n/2] 中与 n 互素、加权 P2 准则最小者：
+// P2 = -1 + 1/n * sum_i prod_j (1 + gamma_j * 2pi^2 * B2({i z_j / n}))，B2(x) = x^2 - x + 1/6，gamma_j = 1 / (j + 1)。
+// 候选超过 1024 个时等间隔抽查
+inline std::vector<uint32_t> korobovVector(uint32_t n, int dim) {
+    auto make = [&](uint64_t a) {
+        std::vector<uint32_t> z(dim);
+        uint64_t x = 1;
+        for (int j = 0; j < dim; j++) z[j] = x, x = x * a % n;
+        return z;
+    };
+    std::vector<double> b2(n);
+    for (uint32_t i = 0; i < n; i++) {
+        double x = 1.0 * i / n;
+        b2[i] = 2 * M_PI * M_PI * (x * x - x + 1.0 / 6);
+    }
+    uint64_t half = std::max(1u, n / 2), step = std::max<uint64_t>(1, half / 1024);
+    uint64_t best_a = 1;
+    double best = INFINITY;
+    for (uint64_t a = 1; a <= half; a += step) {
+        if (std::gcd(a, (uint64_t)n) != 1) continue;
+        std::vector<uint32_t> z = make(a);
+        double sum = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            double prod = 1;
+            for (int j = 0; j < dim; j++) prod *= 1 + b2[i * z[j] % n] / (j + 1);
+            sum += prod;
+        }
+        if (sum / n - 1 < best) best = sum / n - 1, best_a = a;
+    }
+    return make(best_a);
+}
+
+// 格点数为 n 时的生成向量，每个 n 第一次用到时搜索（qmc_points 在两次运行之间可以改变）
+inline const std::vector<uint32_t>& latticeVector(uint32_t n) {
+    static std::mutex mutex;
+    static std::unordered_map<uint32_t, std::vector<uint32_t>> vectors;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = vectors.find(n);
+    if (it == vectors.end()) it = vectors.emplace(n, korobovVector(n, QMC_DIM)).first;
+    return it->second;
+}
+
+// 格点流：一次模拟取格点的第 i 个点，第 k 个均匀数为第 k 维坐标 x = {i * z_k / n + shift_k}
+// 再做 baker 变换 1 - |2x - 1|（对非周期的被积函数误差阶更好），经 uniform01 直接交给模拟，取值 [0, 1]；
+// 用完 QMC_DIM 维后改取 tail 流
+class LatticeStream {
+public:
+    LatticeStream(const uint32_t* z, uint32_t n, uint32_t i, const double* shift, PhiloxStream tail)
+        : z(z), n(n), i(i), shift(shift), tail(tail) {}
+
+    double uniform() {
+        if (dim >= QMC_DIM) return uniform01(tail);
+        double x = 1.0 * ((uint64_t)i * z[dim] % n) / n + shift[dim];
+        dim++;
+        x -= std::floor(x);
+        return 1 - std::abs(2 * x - 1);
+    }
+
+private:
+    const uint32_t* z;
+    uint32_t n, i;
+    const double* shift;
+    PhiloxStream tail;
+    int dim = 0;
+};
+
+// 格点流的对偶：坐标 u 变为 1 - u
+template <>
+class MirroredStream<LatticeStream> {
+public:
+    explicit MirroredStream(LatticeStream s) : stream(s) {}
+    double uniform() { return 1 - stream.uniform(); }
+
+private:
+    LatticeStream stream;
+};
+
+// 与 simulateGame 同一局模拟，同时用同样的骰子推进一局每分得分概率固定为 p0 的对照局：
+// 势能局这一分 A 得分当且仅当 dice / (elo1 + elo2) <= 当前得分概率，对照局则比较 p0。
+// 势能局结束后对照局继续用同一条流的后续随机数打完，所以势能局的结果与 simulateGame 逐位相同。
+// 返回 {胜者, 模拟的分数, 对照局胜者}
+template <class RNG>
+std::tuple<int, int, int> simulateGameWithControl(MomentumWindow window, int scr1, int scr2, int game_idx,
+                                                  double p0, RNG& rng) {
+    int cur_scr1 = scr1, cur_scr2 = scr2, fix_scr1 = scr1, fix_scr2 = scr2;
+    int cnt = 0;
+    while (!isGameOver(cur_scr1, cur_scr2)) {
+        double current_M1 = std::abs(window.M_A);
+        double current_M2 = std::abs(window.M_B);
+        double current_elo1 = calculateEloRating(playerA, current_M1, current_M2 - current_M1);
+        double current_elo2 = calculateEloRating(playerB, current_M2, current_M1 - current_M2);
+        double dice = uniform01(rng) * (current_elo1 + current_elo2);
+        if (!isGameOver(fix_scr1, fix_scr2)) (dice <= p0 * (current_elo1 + current_elo2) ? fix_scr1 : fix_scr2)++;
+        if (dice <= current_elo1) {
+            cur_scr1++;
+            window.push(current_elo1, 0.0, game_idx);
+        } else {
+            cur_scr2++;
+            window.push(0.0, -current_elo2, game_idx);
+        }
+        cnt++;
+        window.update_momentum(game_idx);
+    }
+    while (!isGameOver(fix_scr1, fix_scr2)) (uniform01(rng) <= p0 ? fix_scr1 : fix_scr2)++;
+    return {isGameOver(cur_scr1, cur_scr2), cnt, isGameOver(fix_scr1, fix_scr2)};
+}
+
+// 重要性抽样版的 simulateGameWithControl：势能局每分 A 的得分概率 q 在对数几率上加 theta 后再抽样，
+// 即均匀数 v 落在 [0, q') 时映射到 [0, q)、否则映射到 [q, 1)，q' = sigmoid(logit(q) + theta)；
+// 映射后的 u 仍按原规则决定两局的这一分，所以对照局也跟着倾斜。
+// 路径的似然比为每分 q / q'（A 得分）或 (1 - q) / (1 - q')（B 得分）之积，势能局结束后的对照局不倾斜。
+// 返回 {胜者, 模拟的分数, 对照局胜者, 似然比}
+template <class RNG>
+std::tuple<int, int, int, double> simulateGameTilted(MomentumWindow window, int scr1, int scr2, int game_idx,
+                                                     double p0, double theta, RNG& rng) {
+    int cur_scr1 = scr1, cur_scr2 = scr2, fix_scr1 = scr1, fix_scr2 = scr2;
+    int cnt = 0;
+    double weight = 1;
+    double tilt = std::exp(theta);
+    while (!isGameOver(cur_scr1, cur_scr2)) {
+        double current_M1 = std::abs(window.M_A);
+        double current_M2 = std::abs(window.M_B);
+        double current_elo1 = calculateEloRating(playerA, current_M1, current_M2 - current_M1);
+        double current_elo2 = calculateEloRating(playerB, current_M2, current_M1 - current_M2);
+        double q = current_elo1 / (current_elo1 + current_elo2);
+        double q_tilted = q * tilt / (q * tilt + 1 - q);
+        double v = uniform01(rng);
+        bool a_wins = v <= q_tilted;
+        double u = a_wins ? v * q / q_tilted : q + (v - q_tilted) * (1 - q) / (1 - q_tilted);
+        if (!isGameOver(fix_scr1, fix_scr2)) (u <= p0 ? fix_scr1 : fix_scr2)++;
+        if (a_wins) {
+            cur_scr1++;
+            weight *= q / q_tilted;
+            window.push(current_elo1, 0.0, game_idx);
+        } else {
+            cur_scr2++;
+            weight *= (1 - q) / (1 - q_tilted);
+            window.push(0.0, -current_elo2, game_idx);
+        }
+        cnt++;
+        window.update_momentum(game_idx);
+    }
+    while (!isGameOver(fix_scr1, fix_scr2)) (uniform01(rng) <= p0 ? fix_scr1 : fix_scr2)++;
+    return {isGameOver(cur_scr1, cur_scr2), cnt, isGameOver(fix_scr1, fix_scr2), weight};
+}
+
+// 重要性抽样的倾斜量：让每分得分概率固定为 p0 的对照局里落后方 trail 从当前比分起的本局胜率回到 1/2。
+// 比分相同时不倾斜；返回值为 A 一方的对数几率增量（落后方为 B 时取负）
+inline double importanceTilt(double p0, int scr1, int scr2) {
+    if (scr1 == scr2) return 0;
+    bool trail_a = scr1 < scr2;
+    double logit0 = std::log(p0 / (1 - p0)) * (trail_a ? 1 : -1);
+    auto trail_prob = [&](double theta) {
+        double p = 1 / (1 + std::exp(-(logit0 + theta)));
+        return trail_a ? Core::fixedGameProb(p, scr1, scr2) : Core::fixedGameProb(p, scr2, scr1);
+    };
+    double lo = 0, hi = 8;
+    if (trail_prob(lo) >= 0.5) return 0;
+    for (int it = 0; it < 40; it++) {
+        double mid = (lo + hi) / 2;
+        (trail_prob(mid) < 0.5 ? lo : hi) = mid;
+    }
+    return trail_a ? hi : -hi;
+}
+
+// 方差缩减的效果统计：同样的模拟次数下普通蒙特卡洛的方差 p(1-p)/n 与实际估计量方差之和（单次胜率 p 的，不是 L 的）
+struct VarianceStats {
+    long long calls = 0, rollouts = 0;
+    double plain_var = 0, reduced_var = 0;
+
+    void add(long long n, double plain, double reduced) {
+        std::lock_guard<std::mutex> lock(mtx);
+        calls++, rollouts += n, plain_var += plain, reduced_var += reduced;
+    }
+
+private:
+    std::mutex mtx;
+};
+inline VarianceStats variance_stats;
+
+// 方差缩减的胜率估计。一个样本单元是一次模拟，--antithetic 时是一对互为镜像的模拟（取平均）。
+// --control-variate：对照局的胜率有解析解 fixedGameProb(p0, 比分)，p0 为模拟开始时的得分概率；
+// 势能局与对照局共用骰子，结果高度相关，估计量 mean(Y) - c * (mean(X) - E[X])，
+// c = Cov(Y, X) / Var(X) 由同一批样本估计。
+// --qmc：样本单元的骰子取自格点，每组 qmc_points 个单元共用一个随机平移；组内样本不独立，
+// 标准误取各组估计值的样本方差 / 组数（控制变量时 c 由全部样本估计，各组共用）。
+// --importance：比分不平时按 importanceTilt 倾斜（见 simulateGameTilted），改为估计落后方的胜率，
+// Y、X 和剩余分数都乘以似然比，A 落后时直接得到 p1，B 落后时 p1 = 1 - 估计值。
+// --adaptive 时按估计量自身的标准误停止（--qmc 时逐组追加），否则固定 10000 次模拟或 qmc_replicates 组；
+// 有线程池时按 MC_CHUNK_SIZE 分块并行
+inline WinRateEstimate winningRateReduced(const MatchContext& ctx, int scr1, int scr2, int game_idx) {
+    const int per_unit = use_antithetic ? 2 : 1;
+    MomentumWindow seed = get_sim_window(ctx, game_idx);
+    double p0 = nextPointProb(seed);
+    double theta = use_importance ? importanceTilt(p0, scr1, scr2) : 0;
+    const int target = theta < 0 ? 2 : 1;  // 估计哪一方赢下本局的概率
+    double expected_x = Core::fixedGameProb(p0, scr1, scr2);
+    if (target == 2) expected_x = 1 - expected_x;
+
+    struct Sums {
+        double y = 0, x = 0, yy = 0, xx = 0, xy = 0, cnt = 0;
+        long long n = 0;
+        void add(const Sums& o) { y += o.y, x += o.x, yy += o.yy, xx += o.xx, xy += o.xy, cnt += o.cnt, n += o.n; }
+    };
+    // 用一条流模拟一次，返回 {Y, X, 剩余分数}
+    auto sample = [&](auto& stream) -> std::array<double, 3> {
+        if (theta != 0) {
+            auto [winner, c, fixed, w] = simulateGameTilted(seed, scr1, scr2, game_idx, p0, theta, stream);
+            return {w * (winner == target), w * (fixed == target), w * c};
+        }
+        if (use_control_variate) {
+            auto [winner, c, fixed] = simulateGameWithControl(seed, scr1, scr2, game_idx, p0, stream);
+            return {1.0 * (winner == 1), 1.0 * (fixed == 1), 1.0 * c};
+        }
+        auto [winner, c] = simulateGame(seed, scr1, scr2, game_idx, stream);
+        return {1.0 * (winner == 1), 0.0, 1.0 * c};
+    };
+    // make_stream() 每次返回同一条新流，--antithetic 时第二次取来做镜像
+    auto run_unit = [&](auto make_stream, Sums& s) {
+        auto stream = make_stream();
+        auto [y, x, cnt] = sample(stream);
+        if (use_antithetic) {
+            MirroredStream mirror(make_stream());
+            auto [y2, x2, cnt2] = sample(mirror);
+            y = (y + y2) / 2, x = (x + x2) / 2, cnt = (cnt + cnt2) / 2;
+        }
+        s.y += y, s.x += x, s.yy += y * y, s.xx += x * x, s.xy += x * y, s.cnt += cnt, s.n++;
+    };
+    // 控制变量系数 Cov(Y, X) / Var(X)，不用控制变量或 X 无变化时为 0
+    auto cv_coef = [&](const Sums& s) {
+        double n = s.n, my = s.y / n, mx = s.x / n;
+        double var_x = std::max(0.0, s.xx / n - mx * mx);
+        if (!use_control_variate || var_x <= 0) return 0.0;
+        return (s.xy / n - mx * my) / var_x;
+    };
+    // 由累计量给出 {估计值, 估计量的方差}
+    auto estimate = [&](const Sums& s) {
+        double n = s.n, my = s.y / n, mx = s.x / n;
+        double var_y = std::max(0.0, s.yy / n - my * my), var_x = std::max(0.0, s.xx / n - mx * mx);
+        double cov = s.xy / n - mx * my;
+        if (!use_control_variate || var_x <= 0) return std::make_pair(my, var_y / n);
+        double c = cov / var_x;
+        return std::make_pair(my - c * (mx - expected_x), std::max(0.0, var_y - cov * cov / var_x) / n);
+    };
+    // --qmc：由各组累计量给出 {估计值, 组间方差 / 组数}
+    auto estimate_replicates = [&](const std::vector<Sums>& reps, const Sums& total) {
+        double c = cv_coef(total), mean = 0, m2 = 0;
+        for (size_t r = 0; r < reps.size(); r++) {
+            double p_r = reps[r].y / reps[r].n - c * (reps[r].x / reps[r].n - expected_x);
+            double d = p_r - mean;
+            mean += d / (r + 1);
+            m2 += d * (p_r - mean);
+        }
+        double k = reps.size();
+        return std::make_pair(mean, m2 / (k - 1) / k);
+    };
+    // 样本全为 0 或全为 1 时估计的方差为 0，与 winningRateAdaptive 一样改用 (win + 2) / (n + 4)，避免过早停止
+    auto stop_var = [&](const Sums& total, double var) {
+        if (total.y != 0 && total.y != total.n) return var;
+        double rollouts = total.n * per_unit;
+        double p_adj = (total.y * per_unit + 2.0) / (rollouts + 4.0);
+        return p_adj * (1 - p_adj) / rollouts;
+    };
+
+    Sums total;
+    std::pair<double, double> result;
+    if (use_qmc) {
+        const uint32_t n = qmc_points;
+        const std::vector<uint32_t>& z = latticeVector(n);
+        const int chunks_per_rep = (n + MC_CHUNK_SIZE - 1) / MC_CHUNK_SIZE;
+        std::vector<Sums> reps;
+        std::vector<double> shifts;
+        // 追加第 [r0, r1) 组；平移量取自专用的流（模拟序号从 UINT32_MAX 往下数，不与 tail 流重叠）
+        auto run_replicates = [&](int r0, int r1) {
+            reps.resize(r1), shifts.resize(r1 * QMC_DIM);
+            for (int r = r0; r < r1; r++) {
+                PhiloxStream s = ctx.rolloutStream(UINT32_MAX - r);
+                for (int j = 0; j < QMC_DIM; j++) shifts[r * QMC_DIM + j] = uniform01(s);
+            }
+            std::vector<Sums> chunk_sums((r1 - r0) * chunks_per_rep);
+            auto run_chunk = [&](int t) {
+                int r = r0 + t / chunks_per_rep;
+                uint32_t begin = (t % chunks_per_rep) * MC_CHUNK_SIZE, end = std::min(n, begin + MC_CHUNK_SIZE);
+                const double* shift = &shifts[r * QMC_DIM];
+                for (uint32_t i = begin; i < end; i++) {
+                    run_unit([&] { return LatticeStream(z.data(), n, i, shift, ctx.rolloutStream(r * n + i)); },
+                             chunk_sums[t]);
+                }
+            };
+            if (pool) pool->parallel_for(chunk_sums.size(), run_chunk);
+            else for (size_t t = 0; t < chunk_sums.size(); t++) run_chunk(t);
+            for (size_t t = 0; t < chunk_sums.size(); t++) {
+                reps[r0 + t / chunks_per_rep].add(chunk_sums[t]);
+                total.add(chunk_sums[t]);
+            }
+        };
+        run_replicates(0, use_adaptive ? QMC_MIN_REPLICATES : qmc_replicates);
+        if (use_adaptive) {
+            while ((long long)(reps.size() + 1) * n * per_unit <= max_batch &&
+                   std::sqrt(stop_var(total, estimate_replicates(reps, total).second)) > target_se) {
+                run_replicates(reps.size(), reps.size() + 1);
+            }
+        }
+        result = estimate_replicates(reps, total);
+    } else if (use_adaptive) {
+        int block = std::max(1, ADAPTIVE_BLOCK / per_unit);
+        while (total.n * per_unit < max_batch) {
+            int k0 = total.n;
+            for (int k = k0; k < k0 + block && k * per_unit < max_batch; k++) {
+                run_unit([&] { return ctx.rolloutStream(k); }, total);
+            }
+            if (total.n * per_unit < MIN_BATCH) continue;
+            if (std::sqrt(stop_var(total, estimate(total).second)) <= target_se) break;
+        }
+        result = estimate(total);
+    } else {
+        int units = 10000 / per_unit;
+        int chunks = (units + MC_CHUNK_SIZE - 1) / MC_CHUNK_SIZE;
+        std::vector<Sums> chunk_sums(chunks);
+        auto run_chunk = [&](int c) {
+            int begin = c * MC_CHUNK_SIZE, end = std::min(units, begin + MC_CHUNK_SIZE);
+            for (int k = begin; k < end; k++) run_unit([&] { return ctx.rolloutStream(k); }, chunk_sums[c]);
+        };
+        if (pool) pool->parallel_for(chunks, run_chunk);
+        else for (int c = 0; c < chunks; c++) run_chunk(c);
+        for (const Sums& s : chunk_sums) total.add(s);
+        result = estimate(total);
+    }
+
+    long long rollouts = total.n * per_unit;
+    rollout_count += rollouts;
+    auto [p, var] = result;
+    if (target == 2) p = 1 - p;
+    p = std::min(1.0, std::max(0.0, p));
+    double plain_p = theta != 0 ? p : total.y / total.n;  // 加权后的 Y 不再是 0/1，按估计值换算普通蒙特卡洛的方差
+    variance_stats.add(rollouts, plain_p * (1 - plain_p) / rollouts, var);
+    double se = std::sqrt(var);
+    return {p, 1 - p, total.cnt / total.n, se, std::max(0.0, p - 1.96 * se), std::min(1.0, p + 1.96 * se), (int)rollouts};
+}
+
+/******************************variance reduction****************************/
+
+// 近似精确求解（截断历史的动态规划）：势能只看最近 WINDOW_SIZE 分，把模拟过程截断成有限状态的马尔可夫链。
+// 状态 = (比分, 已模拟分数 step(封顶 WINDOW_SIZE), 最近 WINDOW_SIZE 分的胜负位)，
+// 平分（10:10 以后）折叠成 10:10 / 11:10 / 10:11 三种。
+// 窗口内容由“真实历史窗口 + 按胜负位重放的模拟分”确定：step < WINDOW_SIZE 时与蒙特卡洛的转移概率完全一致；
+// step == WINDOW_SIZE 时窗口全是模拟分，它们的 G 实际取决于窗口之前的整条模拟路径，这里以真实历史为起点
+// 重放得到，是近似（只影响 elo 的二阶小量）。要完全精确需要把整条路径放进状态，平分阶段无法有限化。
+// 因此 --exact 的结果不含抽样误差，但与蒙特卡洛的期望值仍有这部分截断偏差，作为参照时应注意。
+struct ExactSolver {
+    static const int SCORE_DIM = 12;                 // 折叠后比分不超过 11
+    static const int STEP_DIM = WINDOW_SIZE + 1;
+    static const int MASK = (1 << WINDOW_SIZE) - 1;
+
+    struct Value {
+        double p1 = 0.0;   // A 赢下本局的概率
+        double cnt = 0.0;  // 本局剩余分数的期望
+        bool done = false;
+    };
+
+    unsigned long long seed_version = 0;  // 种子对应的 history_version（0 表示未初始化）
+    int game_idx = -1;
+    MomentumWindow seed;              // 真实历史窗口
+    std::vector<Value> memo;
+    bool deuce_solved = false;
+
+    static int index(int a, int b, int step, int bits) {
+        return ((a * SCORE_DIM + b) * STEP_DIM + step) * (MASK + 1) + bits;
+    }
+
+    static void fold(int& a, int& b) {
+        if (a >= 10 && b >= 10) {
+            int d = a - b;
+            a = 10 + std::max(d, 0);
+            b = 10 + std::max(-d, 0);
+        }
+    }
+
+    void reset(const MatchContext& ctx, int g_idx) {
+        seed_version = ctx.history_version;
+        game_idx = g_idx;
+        seed = get_sim_window(ctx, game_idx);
+        memo.assign(SCORE_DIM * SCORE_DIM * STEP_DIM * (MASK + 1), Value());
+        deuce_solved = false;
+    }
+
+    // 状态对应的下一分 A 得分概率
+    double point_prob(int step, int bits) const {
+        MomentumWindow window = seed;
+        for (int k = step - 1; k >= 0; k--) {
+            double M1 = std::abs(window.M_A), M2 = std::abs(window.M_B);
+            double elo1 = calculateEloRating(playerA, M1, M2 - M1);
+            double elo2 = calculateEloRating(playerB, M2, M1 - M2);
+            if (bits >> k & 1) window.push(elo1, 0.0, game_idx);
+            else window.push(0.0, -elo2, game_idx);
+            window.update_momentum(game_idx);
+        }
+        return nextPointProb(window);
+    }
+
+    // 平分阶段且 step == WINDOW_SIZE 的状态互相成环，用值迭代求解
+    void solve_deuce() {
+        deuce_solved = true;
+        const int scores[3][2] = {{10, 10}, {11, 10}, {10, 11}};
+        std::vector<double> prob(MASK + 1);
+        for (int bits = 0; bits <= MASK; bits++) prob[bits] = point_prob(WINDOW_SIZE, bits);
+        for (int iter = 0; iter < 100000; iter++) {
+            double diff = 0;
+            for (auto& sc : scores) {
+                for (int bits = 0; bits <= MASK; bits++) {
+                    double p = prob[bits];
+                    Value win = child(sc[0] + 1, sc[1], WINDOW_SIZE, (bits << 1 & MASK) | 1);
+                    Value lose = child(sc[0], sc[1] + 1, WINDOW_SIZE, bits << 1 & MASK);
+                    Value& v = memo[index(sc[0], sc[1], WINDOW_SIZE, bits)];
+                    double p1 = p * win.p1 + (1 - p) * lose.p1;
+                    double cnt = 1 + p * win.cnt + (1 - p) * lose.cnt;
+                    diff = std::max(diff, std::max(std::abs(p1 - v.p1), std::abs(cnt - v.cnt)));
+                    v.p1 = p1, v.cnt = cnt;
+                }
+            }
+            if (diff < 1e-15) break;
+        }
+        for (auto& sc : scores)
+            for (int bits = 0; bits <= MASK; bits++) memo[index(sc[0], sc[1], WINDOW_SIZE, bits)].done = true;
+    }
+
+    // 值迭代中读取子状态（不递归）
+    Value child(int a, int b, int step, int bits) const {
+        int over = isGameOver(a, b);
+        if (over) return {over == 1 ? 1.0 : 0.0, 0.0, true};
+        fold(a, b);
+        return memo[index(a, b, step, bits)];
+    }
+
+    Value solve(int a, int b, int step, int bits) {
+        int over = isGameOver(a, b);
+        if (over) return {over == 1 ? 1.0 : 0.0, 0.0, true};
+        fold(a, b);
+        Value& v = memo[index(a, b, step, bits)];
+        if (v.done) return v;
+        if (a >= 10 && b >= 10 && step == WINDOW_SIZE) {
+            solve_deuce();
+            return memo[index(a, b, step, bits)];
+        }
+        double p = point_prob(step, bits);
+        int next_step = std::min(step + 1, WINDOW_SIZE);
+        Value win = solve(a + 1, b, next_step, (bits << 1 & MASK) | 1);
+        Value lose = solve(a, b + 1, next_step, bits << 1 & MASK);
+        Value& res = memo[index(a, b, step, bits)];
+        res.p1 = p * win.p1 + (1 - p) * lose.p1;
+        res.cnt = 1 + p * win.cnt + (1 - p) * lose.cnt;
+        res.done = true;
+        return res;
+    }
+};
+
+inline std::tuple<double, double, double> winningRateExact(const MatchContext& ctx, int scr1, int scr2, int game_idx) {
+    // calc_leverage 的三次调用共享同一段历史，记忆化表可以复用；
+    // 每个线程一份，版本号全局唯一，换了比赛也能正确失效
+    thread_local ExactSolver solver;
+    if (solver.seed_version != ctx.history_version || solver.game_idx != game_idx) solver.reset(ctx, game_idx);
+    ExactSolver::Value v = solver.solve(scr1, scr2, 0, 0);
+    return {v.p1, 1.0 - v.p1, v.cnt};
+}
+
+// 胜率缓存：模拟结果在一阶上只取决于折叠后的比分、末尾势能 M_A / M_B 和最近一分是否属于本局，
+// 以这些量（势能按 cache_quantum 量化）为键。未命中时不在触发查询的那一分的历史上计算，
+// 而是在键对应的规范历史上计算（canonicalContext），随机数流也由键决定，
+// 因此缓存的值只取决于键和种子，与哪一分先算到、批量模式下的调度顺序无关。
+class WinRateCache {
+public:
+    // 比分 2 项 + 末尾势能 2 项 + 最近一分的归属（0 无历史，1 本局，2 上一局）
+    using Key = std::array<int32_t, 5>;
+    using Value = std::tuple<double, double, double>;
+
+    long long hits = 0, misses = 0, evictions = 0;
+
+    static Key make_key(int scr1, int scr2, int game_idx, const MomentumWindow& seed) {
+        auto q = [](double x) { return (int32_t)std::llround(x / cache_quantum); };
+        if (scr1 >= 10 && scr2 >= 10) {
+            int d = scr1 - scr2;
+            scr1 = 10 + std::max(d, 0);
+            scr2 = 10 + std::max(-d, 0);
+        }
+        if (seed.empty()) return {scr1, scr2, 0, 0, 0};
+        return {scr1, scr2, q(seed.M_A), q(seed.M_B), seed.at(seed.count - 1).game_idx == game_idx ? 1 : 2};
+    }
+
+    // 键对应的规范历史：WINDOW_SIZE 分的 G 都等于量化后的势能（于是势能恰为量化值），同属键记录的那一局。
+    // 随机数流的分序号由势能部分的键得到：同一分的三个比分共用一组流，与不用缓存时一样配对
+    static MatchContext canonicalContext(const Key& key, int game_idx) {
+        MatchContext canon;
+        canon.match = UINT32_MAX;
+        if (key[4] != 0) {
+            double M_A = key[2] * cache_quantum, M_B = key[3] * cache_quantum;
+            int g = key[4] == 1 ? game_idx : game_idx - 1;
+            canon.all_points.assign(WINDOW_SIZE, PointInfo(M_A, M_B, M_A, M_B, g));
+        }
+        uint64_t h = 0xcbf29ce484222325ULL;
+        for (int j = 2; j < 5; j++) h = (h ^ (uint32_t)key[j]) * 0x100000001b3ULL;
+        canon.point_key = (uint32_t)(h ^ h >> 32);
+        if (canon.point_key == UINT32_MAX) canon.point_key--;
+        canon.touch();
+        return canon;
+    }
+
+    bool find(const Key& key, Value& value) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = index.find(key);
+        if (it == index.end()) {
+            misses++;
+            return false;
+        }
+        hits++;
+        lru.splice(lru.begin(), lru, it->second);
+        value = it->second->second;
+        return true;
+    }
+
+    void insert(const Key& key, const Value& value) {
+        if (cache_capacity == 0) return;
+        std::lock_guard<std::mutex> lock(mtx);
+        if (index.count(key)) return;  // 批量模式下别的线程可能已经算过
+        if (index.size() >= cache_capacity) {
+            index.erase(lru.back().first);
+            lru.pop_back();
+            evictions++;
+        }
+        lru.emplace_front(key, value);
+        index[key] = lru.begin();
+    }
+
+    size_t size() const { return index.size(); }
+
+    // 清空缓存的状态（计数保留）
+    void clear() {
+        std::lock_guard<std::mutex> lock(mtx);
+        lru.clear();
+        index.clear();
+    }
+
+private:
+    std::mutex mtx;  // 批量模式下多个线程共用
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            uint64_t h = 0xcbf29ce484222325ULL;
+            for (int32_t x : key) h = (h ^ (uint32_t)x) * 0x100000001b3ULL;
+            return h;
+        }
+    };
+    std::list<std::pair<Key, Value>> lru;
+    std::unordered_map<Key, std::list<std::pair<Key, Value>>::iterator, KeyHash> index;
+};
+inline WinRateCache win_rate_cache;
+
+// 带置信区间的胜率估计：方差缩减优先，否则为自适应蒙特卡洛
+inline WinRateEstimate winningRateEstimate(const MatchContext& ctx, int scr1, int scr2, int game_idx) {
+    if (use_antithetic || use_control_variate || use_qmc || use_importance)
+        return winningRateReduced(ctx, scr1, scr2, game_idx);
+    return winningRateAdaptive(ctx, scr1, scr2, game_idx);
+}
+
+// 当前选项下 winningRate 实际使用的求解方式（按优先级）
+enum class WinRateSolver { Exact, Reduced, Adaptive, Lockstep, Parallel, MonteCarlo };
+
+inline WinRateSolver winRateSolver() {
+    if (solver_mode == SolverMode::Exact) return WinRateSolver::Exact;
+    if (use_antithetic || use_control_variate || use_qmc || use_importance) return WinRateSolver::Reduced;
+    if (use_adaptive) return WinRateSolver::Adaptive;
+    if (simd_level != SimdLevel::Off) return WinRateSolver::Lockstep;
+    if (pool) return WinRateSolver::Parallel;
+    return WinRateSolver::MonteCarlo;
+}
+
+inline const char* winRateSolverName(WinRateSolver solver) {
+    switch (solver) {
+        case WinRateSolver::Exact: return "exact";
+        case WinRateSolver::Reduced: return "variance_reduced";
+        case WinRateSolver::Adaptive: return "adaptive";
+        case WinRateSolver::Lockstep: return "lockstep";
+        case WinRateSolver::Parallel: return "parallel";
+        default: return "montecarlo";
+    }
+}
+
+inline std::tuple<double, double, double> winningRateUncached(const MatchContext& ctx, int scr1, int scr2, int game_idx) {
+    switch (winRateSolver()) {
+        case WinRateSolver::Exact: return winningRateExact(ctx, scr1, scr2, game_idx);
+        case WinRateSolver::Reduced:
+        case WinRateSolver::Adaptive: {
+            WinRateEstimate e = winningRateEstimate(ctx, scr1, scr2, game_idx);
+            return {e.p1, e.p2, e.avg_cnt};
+        }
+        case WinRateSolver::Lockstep: return winningRateLockstep(ctx, scr1, scr2, game_idx);
+        case WinRateSolver::Parallel: return winningRateParallel(ctx, scr1, scr2, game_idx);
+        default: return winningRateMonteCarlo(ctx, scr1, scr2, game_idx);
+    }
+}
+
+inline std::tuple<double, double, double> winningRate(const MatchContext& ctx, int scr1, int scr2, int game_idx) {
+    if (!use_cache) return winningRateUncached(ctx, scr1, scr2, game_idx);
+    WinRateCache::Key key = WinRateCache::make_key(scr1, scr2, game_idx, get_sim_window(ctx, game_idx));
+    WinRateCache::Value value;
+    if (win_rate_cache.find(key, value)) return value;
+    value = winningRateUncached(WinRateCache::canonicalContext(key, game_idx), key[0], key[1], game_idx);
+    win_rate_cache.insert(key, value);
+    return value;
+}
+
+// 公共随机数（CRN）融合估计：赢/输两个分支消耗同一次模拟的同一条随机数流，
+// rtwp_win - rtwp_lose 中的噪声大部分相互抵消。剩余分数不再单独模拟，
+// 由两个分支按当前分的得分概率加权得到：cnt = 1 + p * cnt_win + (1 - p) * cnt_lose
+// （分支的历史里不含这一分本身，对衰减权重只有很小的影响）。
+// 默认路径的三次调用用的也是同一组随机数流，所以这里的节省只来自省掉当前比分的模拟（三次中的一次）；
+// 当前比分的一次模拟本身就是某个分支的一次模拟，再把它拆给三个估计会丢掉另一个分支的样本，方差反而变大。
+inline std::tuple<double, double, double> leverageCRN(const MatchContext& ctx, int scr1, int scr2, int game_idx) {
+    int batch_size = 10000;
+    int chunks = (batch_size + MC_CHUNK_SIZE - 1) / MC_CHUNK_SIZE;
+    MomentumWindow seed = get_sim_window(ctx, game_idx);
+    double p = nextPointProb(seed);
+    std::vector<int> chunk_win(chunks), chunk_lose(chunks);
+    std::vector<long long> chunk_cnt_win(chunks), chunk_cnt_lose(chunks);
+    auto run_chunk = [&](int c) {
+        int begin = c * MC_CHUNK_SIZE, end = std::min(batch_size, begin + MC_CHUNK_SIZE);
+        for (int i = begin; i < end; i++) {
+            PhiloxStream stream = ctx.rolloutStream(i);
+            PhiloxStream stream_copy = stream;
+            auto [winner_w, cnt_w] = simulateGame(seed, scr1 + 1, scr2, game_idx, stream);
+            auto [winner_l, cnt_l] = simulateGame(seed, scr1, scr2 + 1, game_idx, stream_copy);
+            chunk_win[c] += winner_w == 1;
+            chunk_lose[c] += winner_l == 1;
+            chunk_cnt_win[c] += cnt_w;
+            chunk_cnt_lose[c] += cnt_l;
+        }
+    };
+    if (pool) pool->parallel_for(chunks, run_chunk);
+    else for (int c = 0; c < chunks; c++) run_chunk(c);
+    long long win = 0, lose = 0, cnt_win = 0, cnt_lose = 0;
+    for (int c = 0; c < chunks; c++) {
+        win += chunk_win[c], lose += chunk_lose[c];
+        cnt_win += chunk_cnt_win[c], cnt_lose += chunk_cnt_lose[c];
+    }
+    double cnt = 1 + (p * cnt_win + (1 - p) * cnt_lose) / batch_size;
+    rollout_count += 2LL * batch_size;
+    return {1.0 * win / batch_size, 1.0 * lose / batch_size, cnt};
+}
+
+// 一分的杠杆，连同赢 / 输这一分后 A 赢下本局的概率（比赛层面的胜率由它们组合）
+struct PointLeverage {
+    double L = 0.0;
+    double rtwp_win = 0.0, rtwp_lose = 0.0;
+    double se = -1.0;  // L 的标准误，只有 --budget 时给出
+    double ci = -1.0;  // L 的 95% 置信区间半宽，只有 reportsInterval() 时给出
+};
+
+// L 的 95% 置信区间半宽：赢 / 输两个分支胜率的区间半宽按独立合成（两者共用随机数流，实际区间更窄，偏保守），
+// 区间两端各自按 L 的公式截断后取一半
+inline double leverageInterval(const WinRateEstimate& win, const WinRateEstimate& lose, double cnt) {
+    double h_win = (win.ci_high - win.ci_low) / 2, h_lose = (lose.ci_high - lose.ci_low) / 2;
+    double d = std::sqrt(h_win * h_win + h_lose * h_lose);
+    double diff = win.p1 - lose.p1;
+    return (Core::leverage(diff + d, 0.0, cnt) - Core::leverage(diff - d, 0.0, cnt)) / 2;
+}
+
+inline PointLeverage point_leverage(const MatchContext& ctx, int scr1, int scr2, int game_idx) {
+    if (use_crn && solver_mode == SolverMode::MonteCarlo) {
+        auto [rtwp_win, rtwp_lose, cnt] = leverageCRN(ctx, scr1, scr2, game_idx);
+        return {Core::leverage(rtwp_win, rtwp_lose, cnt), rtwp_win, rtwp_lose};
+    }
+    if (reportsInterval()) {
+        WinRateEstimate win = winningRateEstimate(ctx, scr1 + 1, scr2, game_idx);
+        WinRateEstimate lose = winningRateEstimate(ctx, scr1, scr2 + 1, game_idx);
+        WinRateEstimate now = winningRateEstimate(ctx, scr1, scr2, game_idx);
+        PointLeverage lev{Core::leverage(win.p1, lose.p1, now.avg_cnt), win.p1, lose.p1};
+        lev.ci = leverageInterval(win, lose, now.avg_cnt);
+        return lev;
+    }
+    auto [rtwp_win, _1, _2] = winningRate(ctx, scr1 + 1, scr2, game_idx);
+    auto [rtwp_lose, _3, _4] = winningRate(ctx, scr1, scr2 + 1, game_idx);
+    auto [_5, _6, cnt] = winningRate(ctx, scr1, scr2, game_idx);
+    return {Core::leverage(rtwp_win, rtwp_lose, cnt), rtwp_win, rtwp_lose};
+}
+
+inline double calc_leverage(const MatchContext& ctx, int scr1, int scr2, int game_idx) {
+    return point_leverage(ctx, scr1, scr2, game_idx).L;
+}
+
+// 比赛层面的胜率：局分上的动态规划，V(i, j) = A 在局分 i:j、新一局开始时赢下整场的概率。
+// 之后每一局 A 的胜率取无历史时从 0:0 开始的本局胜率 q（与当前分相同的求解方式，整个程序只算一次）；
+// 跨局势能按 (1 - beta)^d 衰减，几分之后就可以忽略，所以新一局近似从无势能开始。
+// 当前局用逐分求出的本局胜率，P(整场) = P(本局) * V(i + 1, j) + (1 - P(本局)) * V(i, j + 1)，
+// 每分只多几次乘加，不再嵌套模拟
+struct MatchOdds {
+    int need = 0;          // 赢下整场需要的局数
+    double q = 0.5;        // 新一局 A 的胜率
+    std::vector<double> v; // (need + 1) * (need + 1)
+
+    MatchOdds(int best_of, double game_prob) : need(best_of / 2 + 1), q(game_prob), v((need + 1) * (need + 1)) {
+        for (int i = need; i >= 0; i--) {
+            for (int j = need; j >= 0; j--) {
+                if (i == need && j == need) continue;
+                if (i == need) at(i, j) = 1.0;
+                else if (j == need) at(i, j) = 0.0;
+                else at(i, j) = q * at(i + 1, j) + (1 - q) * at(i, j + 1);
+            }
+        }
+    }
+
+    double& at(int i, int j) { return v[i * (need + 1) + j]; }
+    // 局分超出赛制（数据比赛制长）时按已分胜负处理
+    double value(int i, int j) const {
+        if (i >= need) return 1.0;
+        if (j >= need) return 0.0;
+        return v[i * (need + 1) + j];
+    }
+
+    // 局分 games_a:games_b 时，本局胜率为 p_game 的整场胜率
+    double matchProb(int games_a, int games_b, double p_game) const {
+        return p_game * value(games_a + 1, games_b) + (1 - p_game) * value(games_a, games_b + 1);
+    }
+};
+
+inline const MatchOdds& matchOdds() {
+    static const MatchOdds odds = [] {
+        MatchContext fresh;
+        fresh.match = -1;  // 单独的随机数流
+        fresh.touch();
+        return MatchOdds(best_of, std::get<0>(winningRateUncached(fresh, 0, 0, 0)));
+    }();
+    return odds;
+}
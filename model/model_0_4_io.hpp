@@ -0,0 +1,421 @@
+// model_0_4 的输入输出：逐分数据的流式读取、逐分结果（MatchResult）、文本表格和二进制列式结果
+#pragma once
+
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <string_view>
+
+#include "model_0_4_base.hpp"
+
+/******************************match input************************************/
+
+inline std::string input_path;  // --input= 指定逐分数据文件（"-" 为标准输入），为空时分析内置比赛
+inline std::string bin_path;    // --out-bin= 指定二进制结果文件
+inline bool text_output = true; // --no-text 关闭文本表格
+inline bool live_mode = false;  // --live 实时模式：逐分从标准输入读入
+
+// 得分方：1/2 或球员标识，返回 playerA.id / playerB.id，无法识别时返回 0
+inline char parsePointWinner(std::string_view s) {
+    if (s == "1" || (s.size() == 1 && s[0] == playerA.id)) return playerA.id;
+    if (s == "2" || (s.size() == 1 && s[0] == playerB.id)) return playerB.id;
+    return 0;
+}
+
+// 一场比赛的逐分记录：所有分的得分方（playerA.id / playerB.id）连续存放，game_end 记录每局的结束位置
+// 读入多场比赛时复用同一个对象，clear() 保留容量，稳定后不再分配内存
+struct MatchRecord {
+    std::string id;             // 比赛编号
+    std::string player1;        // 对应 playerA 的球员名
+    std::string player2;        // 对应 playerB 的球员名
+    std::string points;         // 每分得分方
+    std::vector<size_t> game_end;
+
+    void clear() {
+        id.clear(), player1.clear(), player2.clear(), points.clear(), game_end.clear();
+    }
+    int games() const { return game_end.size(); }
+    std::string_view game(int g) const {
+        size_t begin = g == 0 ? 0 : game_end[g - 1];
+        return std::string_view(points).substr(begin, game_end[g] - begin);
+    }
+};
+
+// 由按局拆分的得分序列构造比赛记录（内置数据和合成比赛使用）
+inline MatchRecord matchFromGames(const std::vector<std::string>& game_seqs) {
+    MatchRecord match;
+    for (const std::string& seq : game_seqs) {
+        match.points += seq;
+        match.game_end.push_back(match.points.size());
+    }
+    return match;
+}
+
+// 流式读取逐分数据（CSV 或 TSV，按表头自动识别分隔符），每读完一场比赛调用一次 on_match
+// 表头按列名定位，与 2024 MCM C 题温网数据一致：
+//   必需列 match_id、game_no、point_victor（1/2，或球员标识 H/F）；可选列 set_no、player1、player2
+// (set_no, game_no) 变化即视为新的一局；同一场比赛的行须连续。字段原地切分，不支持带分隔符的引号字段
+// 返回读到的比赛数，表头缺少必需列时返回 -1
+class MatchReader {
+public:
+    explicit MatchReader(std::istream& in) : in(in), buf(1 << 16) {}
+
+    template <class F>
+    int readAll(F on_match) {
+        std::string_view line;
+        if (!nextLine(line) || !parseHeader(line)) return -1;
+        int matches = 0;
+        long long line_no = 1;
+        bool open = false;
+        int last_set = -1, last_game = -1;
+        while (nextLine(line)) {
+            line_no++;
+            if (line.empty()) continue;
+            splitFields(line);
+            if (fields.size() <= max_col) {
+                std::cerr << "input line " << line_no << ": expected " << max_col + 1 << " fields, skipped\n";
+                continue;
+            }
+            std::string_view id = fields[col_match];
+            int set_no = col_set >= 0 ? parseInt(fields[col_set]) : 0;
+            int game_no = parseInt(fields[col_game]);
+            char winner = parsePointWinner(fields[col_victor]);
+            if (game_no < 0 || set_no < 0 || winner == 0) {
+                std::cerr << "input line " << line_no << ": bad game_no/set_no/point_victor, skipped\n";
+                continue;
+            }
+
+            if (!open || id != match.id) {
+                if (open) finishMatch(on_match), matches++;
+                match.clear();
+                match.id.assign(id);
+                if (col_p1 >= 0) match.player1.assign(fields[col_p1]);
+                if (col_p2 >= 0) match.player2.assign(fields[col_p2]);
+                open = true;
+                last_set = set_no, last_game = game_no;
+            } else if (set_no != last_set || game_no != last_game) {
+                match.game_end.push_back(match.points.size());
+                last_set = set_no, last_game = game_no;
+            }
+            match.points.push_back(winner);
+        }
+        if (open) finishMatch(on_match), matches++;
+        return matches;
+    }
+
+private:
+    std::istream& in;
+    std::vector<char> buf;
+    size_t begin = 0, end = 0;          // buf 中未处理的数据
+    bool eof = false;
+    char delim = ',';
+    int col_match = -1, col_set = -1, col_game = -1, col_victor = -1, col_p1 = -1, col_p2 = -1;
+    size_t max_col = 0;
+    std::vector<std::string_view> fields;
+    MatchRecord match;
+
+    // 取下一行（不含换行符和行尾 \r）；跨缓冲区的行先把残余数据移到开头再补读，一行超过缓冲区时扩容
+    bool nextLine(std::string_view& line) {
+        while (true) {
+            const char* nl = static_cast<const char*>(memchr(buf.data() + begin, '\n', end - begin));
+            if (nl || (eof && begin < end)) {
+                size_t len = nl ? nl - (buf.data() + begin) : end - begin;
+                line = std::string_view(buf.data() + begin, len);
+                begin += nl ? len + 1 : len;
+                if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+                return true;
+            }
+            if (eof) return false;
+            if (begin > 0) {
+                std::copy(buf.begin() + begin, buf.begin() + end, buf.begin());
+                end -= begin, begin = 0;
+            }
+            if (end == buf.size()) buf.resize(buf.size() * 2);
+            in.read(buf.data() + end, buf.size() - end);
+            end += in.gcount();
+            if (in.gcount() == 0) eof = true;
+        }
+    }
+
+    void splitFields(std::string_view line) {
+        fields.clear();
+        while (true) {
+            size_t pos = line.find(delim);
+            std::string_view field = line.substr(0, pos);
+            if (field.size() >= 2 && field.front() == '"' && field.back() == '"') field = field.substr(1, field.size() - 2);
+            fields.push_back(field);
+            if (pos == std::string_view::npos) break;
+            line.remove_prefix(pos + 1);
+        }
+    }
+
+    bool parseHeader(std::string_view line) {
+        if (line.size() >= 3 && line.substr(0, 3) == "\xEF\xBB\xBF") line.remove_prefix(3);  // UTF-8 BOM
+        delim = line.find('\t') != std::string_view::npos ? '\t' : ',';
+        splitFields(line);
+        for (int i = 0; i < (int)fields.size(); i++) {
+            if (fields[i] == "match_id") col_match = i;
+            else if (fields[i] == "set_no") col_set = i;
+            else if (fields[i] == "game_no") col_game = i;
+            else if (fields[i] == "point_victor") col_victor = i;
+            else if (fields[i] == "player1") col_p1 = i;
+            else if (fields[i] == "player2") col_p2 = i;
+        }
+        if (col_match < 0 || col_game < 0 || col_victor < 0) {
+            std::cerr << "input header must contain match_id, game_no and point_victor\n";
+            return false;
+        }
+        max_col = std::max({col_match, col_set, col_game, col_victor, col_p1, col_p2});
+        return true;
+    }
+
+    static int parseInt(std::string_view s) {
+        int value = -1;
+        auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+        return ec == std::errc() && ptr == s.data() + s.size() ? value : -1;
+    }
+
+    template <class F>
+    void finishMatch(F& on_match) {
+        match.game_end.push_back(match.points.size());
+        on_match(static_cast<const MatchRecord&>(match));
+    }
+};
+
+/******************************match input************************************/
+
+// 一场比赛的逐分结果，按列存放
+struct MatchResult {
+    std::vector<int32_t> point, game, score_a, score_b;          // 第几分、第几局（均从 1 开始）、这一分后的比分
+    std::vector<double> L, G_A, G_B, M_A, M_B, elo_A, elo_B;
+    std::vector<double> P_match, L_match;  // --best-of 时：这一分后 A 赢下整场的概率、这一分对整场胜率的杠杆
+    std::vector<double> L_se;              // --budget 时：L 的标准误
+    std::vector<double> L_ci;              // --adaptive 或方差缩减时：L 的 95% 置信区间半宽
+
+    void clear() {
+        point.clear(), game.clear(), score_a.clear(), score_b.clear();
+        L.clear(), G_A.clear(), G_B.clear(), M_A.clear(), M_B.clear(), elo_A.clear(), elo_B.clear();
+        P_match.clear(), L_match.clear(), L_se.clear(), L_ci.clear();
+    }
+    size_t size() const { return point.size(); }
+};
+
+// 文本输出缓冲：数字用 std::to_chars 格式化（与 std::fixed + setprecision(6) 逐字节相同），
+// 攒满 TABLE_BUFFER_SIZE 字节才整块写给底层流
+const size_t TABLE_BUFFER_SIZE = 1 << 20;
+
+class TableWriter {
+public:
+    explicit TableWriter(std::ostream& out) : out(out), buf(new char[TABLE_BUFFER_SIZE]) {}
+    TableWriter(const TableWriter&) = delete;
+    TableWriter& operator=(const TableWriter&) = delete;
+    ~TableWriter() { flush(); }
+
+    TableWriter& operator<<(std::string_view s) {
+        if (s.size() > TABLE_BUFFER_SIZE - len) {
+            flush();
+            if (s.size() > TABLE_BUFFER_SIZE) {
+                out.write(s.data(), s.size());
+                return *this;
+            }
+        }
+        std::memcpy(buf.get() + len, s.data(), s.size());
+        len += s.size();
+        return *this;
+    }
+
+    TableWriter& operator<<(char c) {
+        reserve(1);
+        buf[len++] = c;
+        return *this;
+    }
+
+    TableWriter& operator<<(long long x) {
+        reserve(24);
+        len = std::to_chars(buf.get() + len, buf.get() + TABLE_BUFFER_SIZE, x).ptr - buf.get();
+        return *this;
+    }
+    TableWriter& operator<<(int x) { return *this << (long long)x; }
+
+    // 定点 6 位小数；double 定点表示最长约 320 字符
+    TableWriter& operator<<(double x) {
+        reserve(400);
+        len = std::to_chars(buf.get() + len, buf.get() + TABLE_BUFFER_SIZE, x, std::chars_format::fixed, 6).ptr - buf.get();
+        return *this;
+    }
+
+    void flush() {
+        if (len) out.write(buf.get(), len);
+        len = 0;
+        out.flush();
+    }
+
+private:
+    std::ostream& out;
+    std::unique_ptr<char[]> buf;
+    size_t len = 0;
+
+    void reserve(size_t n) {
+        if (TABLE_BUFFER_SIZE - len < n) flush();
+    }
+};
+
+// 文本表格的表头（原 freopen 输出的格式）
+inline void printHeader(TableWriter& out) {
+    out << "Point #N\tGame\tScore(" << playerA.id << ":" << playerB.id
+        << ")\tL_i\t\tG_A\t\tG_B\t\tM_A\t\tM_B\t\tElo_" << playerA.id
+        << "\t\tElo_" << playerB.id;
+    if (best_of > 0) out << "\t\tP_match\t\tL_match";
+    if (rollout_budget > 0 && solver_mode == SolverMode::MonteCarlo) out << "\t\tL_se";
+    if (reportsInterval()) out << "\t\tL_ci";
+    out << "\n";
+    out << "-----------------------------------------------------------------------------------------------------------------------------------------------------------------\n";
+}
+
+// 文本表格的一行
+inline void printRow(TableWriter& out, const MatchResult& r, size_t i) {
+    out << r.point[i] << "\t\t" << r.game[i] << '\t'
+        << r.score_a[i] << ':' << r.score_b[i] << "\t\t"
+        << r.L[i] << '\t' << r.G_A[i] << '\t' << r.G_B[i] << '\t'
+        << r.M_A[i] << '\t' << r.M_B[i] << '\t'
+        << r.elo_A[i] << '\t' << r.elo_B[i];
+    if (!r.P_match.empty()) out << '\t' << r.P_match[i] << '\t' << r.L_match[i];
+    if (!r.L_se.empty()) out << '\t' << r.L_se[i];
+    if (!r.L_ci.empty()) out << '\t' << r.L_ci[i];
+    out << '\n';
+}
+
+// 文本表格
+inline void printTable(TableWriter& out, const MatchResult& r) {
+    printHeader(out);
+    for (size_t i = 0; i < r.size(); i++) printRow(out, r, i);
+}
+
+// 外部输入比赛的文本：比赛信息一行 + 逐分表格 + 空行
+inline void printMatch(TableWriter& out, const MatchRecord& match, const MatchResult& result) {
+    out << "Match " << match.id;
+    if (!match.player1.empty()) out << '\t' << match.player1 << " (" << playerA.id << ") vs "
+                                    << match.player2 << " (" << playerB.id << ")";
+    out << '\n';
+    printTable(out, result);
+    out << '\n';
+}
+
+/******************************binary results*********************************/
+
+// 二进制列式结果文件（版本 1，小端，可直接 mmap / numpy.memmap，无需解析）：
+//   文件头 64 字节：magic "MOMRSLT\0" | u32 版本 | u32 列数 | u64 比赛数 | u64 总分数 |
+//                   u64 列目录偏移 | u64 比赛表偏移 | u64 字符串区偏移 | u64 字符串区长度
+//   列目录：每列 32 字节 = char 列名[16] | char numpy dtype[8]（如 "<f8"）| u64 数据偏移，列数据按 64 字节对齐
+//   比赛表：每场 32 字节 = i64 首分下标 | i64 分数 | i64 字符串偏移 | i32 字符串长度 | i32 局数，
+//           字符串为 "match_id\tplayer1\tplayer2"
+//   列依次为 point game score_a score_b L G_A G_B M_A M_B elo_A elo_B，--best-of 时另有 P_match L_match，
+//   --budget 时另有 L_se，--adaptive 或方差缩减时另有 L_ci
+// 结果先按列累积在内存中（每分 68 字节），finish() 时每列一次顺序写出
+class ResultWriter {
+public:
+    static constexpr char MAGIC[8] = {'M', 'O', 'M', 'R', 'S', 'L', 'T', 0};
+    static const uint32_t VERSION = 1;
+
+    void add(const MatchRecord& match, const MatchResult& r) {
+        MatchEntry e;
+        e.first_point = all.size();
+        e.n_points = r.size();
+        e.str_offset = strings.size();
+        strings += match.id;
+        strings += '\t';
+        strings += match.player1;
+        strings += '\t';
+        strings += match.player2;
+        e.str_len = strings.size() - e.str_offset;
+        e.n_games = match.games();
+        entries.push_back(e);
+        append(all.point, r.point), append(all.game, r.game);
+        append(all.score_a, r.score_a), append(all.score_b, r.score_b);
+        append(all.L, r.L), append(all.G_A, r.G_A), append(all.G_B, r.G_B);
+        append(all.M_A, r.M_A), append(all.M_B, r.M_B);
+        append(all.elo_A, r.elo_A), append(all.elo_B, r.elo_B);
+        append(all.P_match, r.P_match), append(all.L_match, r.L_match);
+        append(all.L_se, r.L_se);
+        append(all.L_ci, r.L_ci);
+    }
+
+    bool finish(const std::string& path) {
+        std::vector<Column> columns = {
+            {"point", "<i4", all.point.data(), 4}, {"game", "<i4", all.game.data(), 4},
+            {"score_a", "<i4", all.score_a.data(), 4}, {"score_b", "<i4", all.score_b.data(), 4},
+            {"L", "<f8", all.L.data(), 8}, {"G_A", "<f8", all.G_A.data(), 8}, {"G_B", "<f8", all.G_B.data(), 8},
+            {"M_A", "<f8", all.M_A.data(), 8}, {"M_B", "<f8", all.M_B.data(), 8},
+            {"elo_A", "<f8", all.elo_A.data(), 8}, {"elo_B", "<f8", all.elo_B.data(), 8}};
+        uint64_t n = all.size();
+        if (all.P_match.size() == n && n > 0)
+            columns.push_back({"P_match", "<f8", all.P_match.data(), 8}), columns.push_back({"L_match", "<f8", all.L_match.data(), 8});
+        if (all.L_se.size() == n && n > 0) columns.push_back({"L_se", "<f8", all.L_se.data(), 8});
+        if (all.L_ci.size() == n && n > 0) columns.push_back({"L_ci", "<f8", all.L_ci.data(), 8});
+        uint64_t columns_offset = HEADER_SIZE;
+        uint64_t matches_offset = columns_offset + columns.size() * 32;
+        uint64_t strings_offset = matches_offset + entries.size() * sizeof(MatchEntry);
+        uint64_t offset = align(strings_offset + strings.size());
+        for (Column& c : columns) c.offset = offset, offset = align(offset + n * c.width);
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file) return false;
+        std::vector<char> head(HEADER_SIZE + columns.size() * 32, 0);
+        std::memcpy(&head[0], MAGIC, 8);
+        put(head, 8, VERSION), put(head, 12, (uint32_t)columns.size());
+        put(head, 16, (uint64_t)entries.size()), put(head, 24, n);
+        put(head, 32, columns_offset), put(head, 40, matches_offset);
+        put(head, 48, strings_offset), put(head, 56, (uint64_t)strings.size());
+        for (size_t k = 0; k < columns.size(); k++) {
+            size_t at = columns_offset + k * 32;
+            std::strncpy(&head[at], columns[k].name, 16);
+            std::strncpy(&head[at + 16], columns[k].dtype, 8);
+            put(head, at + 24, columns[k].offset);
+        }
+        file.write(head.data(), head.size());
+        file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(MatchEntry));
+        file.write(strings.data(), strings.size());
+        uint64_t pos = strings_offset + strings.size();
+        static const char zeros[64] = {};
+        for (const Column& c : columns) {
+            file.write(zeros, c.offset - pos);
+            file.write(static_cast<const char*>(c.data), n * c.width);
+            pos = c.offset + n * c.width;
+        }
+        return bool(file);
+    }
+
+private:
+    static const uint64_t HEADER_SIZE = 64;
+
+    struct MatchEntry {
+        int64_t first_point, n_points, str_offset;
+        int32_t str_len, n_games;
+    };
+    static_assert(sizeof(MatchEntry) == 32, "match table entry must be 32 bytes");
+
+    struct Column {
+        const char* name;
+        const char* dtype;
+        const void* data;
+        uint64_t width;
+        uint64_t offset = 0;
+    };
+
+    MatchResult all;
+    std::vector<MatchEntry> entries;
+    std::string strings;
+
+    template <class T>
+    static void append(std::vector<T>& to, const std::vector<T>& from) {
+        to.insert(to.end(), from.begin(), from.end());
+    }
+    static uint64_t align(uint64_t x) { return (x + 63) & ~(uint64_t)63; }
+    template <class T>
+    static void put(std::vector<char>& buf, size_t at, T value) {
+        std::memcpy(&buf[at], &value, sizeof(T));
+    }
+};
+
+/******************************binary results*********************************/
@@ -0,0 +1,61 @@
+// model_0_4 的命令行参数
+#pragma once
+
+#include "model_0_4_estimators.hpp"
+#include "model_0_4_io.hpp"
+
+// 解析命令行参数（模型和各工具共用），不认识的参数忽略
+inline void parseArgs(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--exact") solver_mode = SolverMode::Exact;  // 近似精确（截断历史的动态规划）
+        else if (arg.rfind("--seed=", 0) == 0) rng_seed = std::stoull(arg.substr(7));
+        else if (arg == "--crn") use_crn = true;
+        else if (arg == "--adaptive") use_adaptive = true;
+        else if (arg == "--antithetic") use_antithetic = true;
+        else if (arg == "--control-variate") use_control_variate = true;
+        else if (arg == "--qmc") use_qmc = true;
+        else if (arg == "--importance") use_importance = true;
+        else if (arg == "--cache") use_cache = true;
+        else if (arg == "--batch") batch_mode = true;
+        else if (arg == "--no-text") text_output = false;
+        else if (arg == "--live") live_mode = true;
+        else if (arg.rfind("--out-bin=", 0) == 0) bin_path = arg.substr(10);
+        else if (arg.rfind("--simd=", 0) == 0) {
+            std::string level = arg.substr(7);
+            if (level == "auto") simd_level = SimdLevel::Auto;
+            else if (level == "avx512") simd_level = SimdLevel::AVX512;
+            else if (level == "avx2") simd_level = SimdLevel::AVX2;
+            else if (level == "generic") simd_level = SimdLevel::Generic;
+            else simd_level = SimdLevel::Off;
+            simd_level = resolveSimdLevel(simd_level);
+        }
+        else if (arg.rfind("--cache-quantum=", 0) == 0) cache_quantum = std::stod(arg.substr(16));
+        else if (arg.rfind("--input=", 0) == 0) input_path = arg.substr(8);
+        else if (arg.rfind("--cache-size=", 0) == 0) cache_capacity = std::stoul(arg.substr(13));
+        else if (arg.rfind("--target-se=", 0) == 0) target_se = std::stod(arg.substr(12));
+        else if (arg.rfind("--max-batch=", 0) == 0) max_batch = std::stoi(arg.substr(12));
+        else if (arg.rfind("--qmc-points=", 0) == 0) qmc_points = std::max(2, std::stoi(arg.substr(13)));
+        else if (arg.rfind("--qmc-replicates=", 0) == 0) qmc_replicates = std::max(2, std::stoi(arg.substr(17)));
+        else if (arg == "--speculative") spec_width = -1;
+        else if (arg.rfind("--speculative=", 0) == 0) spec_width = std::max(1, std::stoi(arg.substr(14)));
+        else if (arg.rfind("--spec-tol=", 0) == 0) spec_tol = std::stod(arg.substr(11));
+        else if (arg.rfind("--budget=", 0) == 0) rollout_budget = std::max(0LL, std::stoll(arg.substr(9)));
+        else if (arg == "--budget-objective=leverage") budget_objective = BudgetObjective::Leverage;
+        else if (arg == "--budget-objective=momentum") budget_objective = BudgetObjective::Momentum;
+        else if (arg.rfind("--best-of=", 0) == 0) best_of = std::max(0, std::stoi(arg.substr(10)));
+        else if (arg.rfind("--threads=", 0) == 0) {
+            num_threads = std::stoi(arg.substr(10));
+            if (num_threads <= 0) num_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+    }
+    if (batch_mode && num_threads <= 0) num_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (num_threads > 0 && !batch_mode) {
+        if (spec_width != 0) {
+            if (spec_width < 0) spec_width = 4 * num_threads;
+            spec_pool = std::make_unique<ThreadPool>(num_threads);
+        } else {
+            pool = std::make_unique<ThreadPool>(num_threads);
+        }
+    }
+}
@@ -9,12 +9,17 @@
 #include <sstream>
 #include <tuple>
 
+#include "momentum_core.hpp"
+
 // 随机数生成器
 std::mt19937 gen(std::chrono::system_clock().now().time_since_epoch().count());
 using PDD = std::pair<double, double>;
 
 /********************************definition***********************************/
 
+// 本版本的模型公式（见 momentum_core.hpp）：elo、衰减和局制与 model_0_4 相同
+using Core = momentum::Model04;
+
 // 球员结构体 - 存储球员数据
 struct Player {
     std::string name;    // 球员名称
@@ -23,21 +28,14 @@ struct Player {
     double psy;          // 心理素质
     double sta;          // 状态系数
 
-    double elo(double M_self, double delta_M,
-                       double w_cap = 0.7, double w_M = 0.2, double w_delta_M = 0.1) const {
-        double elo = (cap * w_cap + (M_self * w_M - delta_M * w_delta_M * (1 - psy))) * sta;
-        return sigmoid(elo);
+    double elo(double M_self, double delta_M) const {
+        return Core::elo(*this, M_self, delta_M);
     }
 
     double elo(double w_cap = 0.8, double w_psy = 0.2) {
         double elo = cap * w_cap + psy * w_psy;
         return elo;
     }
-
-private:
-    double sigmoid(double x) const {
-        return 1.0 / (1.0 + std::exp(-x));
-    }
 };
 
 // 存储每一分的元数据（用于权重计算）
@@ -70,9 +68,9 @@ Player& playerB = players[1];
 /*******************************constant value********************************/
 
 // 常量定义
-const double alpha = 0.33;    // 当前局内衰减系数
-const double beta = 0.5;      // 跨局衰减系数
-const int WINDOW_SIZE = 5;    // 势能计算窗口
+const double alpha = Core::Decay::alpha;    // 当前局内衰减系数
+const double beta = Core::Decay::beta;      // 跨局衰减系数
+const int WINDOW_SIZE = Core::WINDOW_SIZE;  // 势能计算窗口
 const std::vector<std::string> get_game_score_seqs() {
     return {
         "HFHHHHHHHHHFH",        // 第1局
@@ -88,12 +86,7 @@ const std::vector<std::string> get_game_score_seqs() {
 /*******************************constant value********************************/
 
 int is_game_over(int score1, int score2) {
-    int maxScore = std::max(score1, score2);
-    int minScore = std::min(score1, score2);
-    if (maxScore >= 11 && maxScore - minScore >= 2) {
-        return (score1 > score2) ? 1 : 2;
-    }
-    return 0;
+    return Core::isGameOver(score1, score2);
 }
 
 void fill(std::vector<PointInfo> points) {
@@ -0,0 +1,336 @@
+// 势能模型公共核心（仅头文件）
+// 各版本模型只在常数和公式形式上不同：elo 的权重和压缩方式、势能衰减的形式、杠杆是否按剩余分数加权。
+// 这些差异写成编译期策略，Model<...> 组合出具体版本，常数全部折叠进内联后的热循环。
+// 目前 model_0_3、model_0_4、model_0_4_1 和 plot/plot.cpp 由这里生成，模拟都走 MomentumWindow 的 O(1) 更新；
+// model_1_0 的 elo、衰减常数和局制取自 Model04，它的模拟（按最近胜负特征更新窗口，fill / simulation）
+// 还是未完成的草稿（winning_rate_montecarlo 未写完，整个文件无法编译），完成后再接入 simulateGame；
+// model_0_0 ~ model_0_2_3 的模拟输入是能力值而非历史，接口不同，未接入。
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace momentum {
+
+/******************************random*****************************************/
+
+// 引擎是否自带 uniform()（直接给出均匀数而非随机位，如 model_0_4 拟蒙特卡洛的格点流）
+template <class RNG, class = void>
+struct HasUniform : std::false_type {};
+template <class RNG>
+struct HasUniform<RNG, std::void_t<decltype(std::declval<RNG&>().uniform())>> : std::true_type {};
+
+// 均匀数。自带 uniform() 的引擎直接取；其余与 uniform_real_distribution<double>(0, 1) 相同，
+// 由 generate_canonical 从随机位拼出、取值 [0, 1)，所以 uniform01(gen) * T 与 uniform_real_distribution(0, T) 逐位相同
+template <class RNG>
+double uniform01(RNG& gen) {
+    if constexpr (HasUniform<RNG>::value) return gen.uniform();
+    else return std::generate_canonical<double, std::numeric_limits<double>::digits>(gen);
+}
+
+/******************************policies***************************************/
+
+// elo = squash((cap * w_cap + M_self * w_M - delta_M * w_delta_M * (1 - psy)) * sta)
+struct EloSigmoid {  // model_0_4 起
+    static constexpr double w_cap = 0.7, w_M = 0.2, w_delta_M = 0.1;
+    static double squash(double x) { return 1.0 / (1.0 + std::exp(-x)); }
+};
+
+struct EloClamp {  // model_0_3 及以前：截断到 [0, 1]
+    static constexpr double w_cap = 0.6, w_M = 0.2, w_delta_M = 0.2;
+    static double squash(double x) { return std::max(0.0, std::min(1.0, x)); }
+};
+
+// 势能衰减：距离最近一分 d 的分权重为 keep[pick(该分的局, 当前局)]^d
+struct DecaySameCross {  // 本局 (1 - alpha)^d，其他局 (1 - beta)^d
+    static constexpr double alpha = 0.33;  // 当前局内衰减系数
+    static constexpr double beta = 0.5;    // 跨局衰减系数
+    static constexpr double keep[2] = {1 - alpha, 1 - beta};
+    static constexpr int pick(int point_game, int game_idx) { return point_game == game_idx ? 0 : 1; }
+};
+
+struct DecayLegacy {  // model_0_3 / plot.cpp：第 1 局的分按 beta^d，其余按 alpha^d
+    static constexpr double alpha = 0.33;
+    static constexpr double beta = 0.5;
+    static constexpr double keep[2] = {alpha, beta};
+    static constexpr int pick(int point_game, int) { return point_game ? 0 : 1; }
+};
+
+// 杠杆：由 赢下这一分 / 输掉这一分 后的本局胜率（及当前状态下本局剩余分数的期望）得到
+struct LeverageDiff {  // model_0_3：两者之差
+    static constexpr bool needs_count = false;
+    static double apply(double win, double lose, double) { return win - lose; }
+};
+
+// 按剩余分数衰减加权并封顶：min((win - lose) * (scale * e^(-rate * (cnt - 1)) + floor), cap)
+template <class P>
+struct LeverageWeighted {
+    static constexpr bool needs_count = true;
+    static double weight(double cnt) {
+        double exponent = -P::rate * (cnt - 1.0);
+        double expResult = std::exp(exponent);
+        return P::scale * expResult + P::floor;
+    }
+    static double apply(double win, double lose, double cnt) {
+        return std::min((win - lose) * weight(cnt), P::cap);
+    }
+};
+struct CountDecay04 { static constexpr double rate = 0.2, scale = 0.7, floor = 0.3, cap = 0.2; };
+struct CountDecayPlot { static constexpr double rate = 0.5, scale = 0.9, floor = 0.1, cap = 0.2; };
+
+// 局制：先到 target 分且领先 margin 分
+struct Game11 {  // 乒乓球 11 分制
+    static constexpr int target = 11, margin = 2;
+};
+
+/******************************policies***************************************/
+
+template <class EloP, class DecayP, class LeverageP, class GameP = Game11, int Window = 5>
+struct Model {
+    using Elo = EloP;
+    using Decay = DecayP;
+    using Leverage = LeverageP;
+    using Game = GameP;
+    static constexpr int WINDOW_SIZE = Window;  // 势能计算窗口
+
+    // 衰减权重表：decay_table[pick][d] = keep[pick]^d
+    static constexpr std::array<std::array<double, Window + 1>, 2> make_decay_table() {
+        std::array<std::array<double, Window + 1>, 2> table{};
+        for (int p = 0; p < 2; p++) {
+            table[p][0] = 1.0;
+            for (int d = 1; d <= Window; d++) table[p][d] = table[p][d - 1] * Decay::keep[p];
+        }
+        return table;
+    }
+    static constexpr auto decay_table = make_decay_table();
+
+    // 判断一局是否结束，1 为 A 胜，2 为 B 胜，0 为未结束
+    static constexpr int isGameOver(int score1, int score2) {
+        int maxScore = std::max(score1, score2);
+        int minScore = std::min(score1, score2);
+        if (maxScore >= Game::target && maxScore - minScore >= Game::margin) return (score1 > score2) ? 1 : 2;
+        return 0;
+    }
+
+    // 每分 A 得分概率固定为 p 时（model_0_0 / model_0_2 的固定概率模型），从 a:b 开始 A 赢下本局的概率。
+    // 双方都到 target - 1 以后只看分差，平分后 A 获胜的概率为 p^2 / (p^2 + (1 - p)^2)
+    static double fixedGameProb(double p, int a, int b) {
+        static_assert(Game::margin == 2, "平分阶段的闭式解只适用于领先 2 分获胜");
+        constexpr int T = Game::target;
+        double q = 1 - p;
+        double deuce = p * p / (p * p + q * q);
+        if (int over = isGameOver(a, b)) return over == 1 ? 1.0 : 0.0;
+        if (a >= T - 1 && b >= T - 1) {
+            int d = a - b;
+            return d == 0 ? deuce : d > 0 ? p + q * deuce : p * deuce;
+        }
+        // f[i][j]：比分 i:j 时 A 的胜率，i 或 j 到 T 为终局
+        std::array<std::array<double, T + 1>, T + 1> f{};
+        for (int i = T; i >= a; i--) {
+            for (int j = T; j >= b; j--) {
+                if (i == T || j == T) f[i][j] = i == T ? 1.0 : 0.0;
+                else if (i == T - 1 && j == T - 1) f[i][j] = deuce;
+                else f[i][j] = p * f[i + 1][j] + q * f[i][j + 1];
+            }
+        }
+        return f[a][b];
+    }
+
+    template <class Player>
+    static double elo(const Player& player, double M_self, double delta_M) {
+        double elo = (player.cap * Elo::w_cap + (M_self * Elo::w_M - delta_M * Elo::w_delta_M * (1 - player.psy))) * player.sta;
+        return Elo::squash(elo);
+    }
+
+    static double leverage(double win, double lose, double cnt) { return Leverage::apply(win, lose, cnt); }
+
+    // 最近 WINDOW_SIZE 分的加权平均，写回最后一分的 M_A / M_B
+    template <class Point>
+    static std::tuple<double, double> momentum(std::vector<Point>& points, int game_idx) {
+        if (points.empty()) return {0.0, 0.0};
+
+        double numerator1 = 0.0, numerator2 = 0.0, denominator = 0.0;
+        int start_idx = std::max(0, (int)points.size() - Window);
+
+        for (size_t k = start_idx; k < points.size(); k++) {
+            int distance = points.size() - 1 - k;
+            double weight = decay_table[Decay::pick(points[k].game_idx, game_idx)][distance];
+            numerator1 += points[k].G_A * weight;
+            numerator2 += points[k].G_B * weight;
+            denominator += weight;
+        }
+
+        double M1 = (denominator != 0) ? numerator1 / denominator : 0.0;
+        double M2 = (denominator != 0) ? numerator2 / denominator : 0.0;
+        points.back().M_A = M1, points.back().M_B = M2;
+        return {M1, M2};
+    }
+
+    // 势能窗口：定长环形缓冲区保存最近 Window 分，整体放在栈上，复制即拷贝，不做任何堆分配。
+    // 按 Decay::pick 分成两类的分各自维护加权和：新增一分时已有的分距离加一，两类加权和分别整体乘 keep，
+    // 再减去被挤出窗口的那一分、加上新的一分，势能更新为 O(1)。
+    // 分类以 ref_game 为“本局”；换局时按新的本局用 O(Window) 重建一次。
+    // 真实比赛和模拟共用这一结构，结果与 momentum() 的定义一致（只差浮点舍入）
+    struct MomentumWindow {
+        struct Entry {
+            double G_A, G_B;
+            int game_idx;
+        };
+        Entry entries[Window];
+        int head = 0;                 // 下一个写入位置（即最旧一分的位置）
+        int count = 0;
+        double M_A = 0.0, M_B = 0.0;  // 最近一分后的势能
+
+        int ref_game = -1;                                       // 分类对应的本局
+        double sum_A[2] = {0.0, 0.0}, sum_B[2] = {0.0, 0.0};     // 两类分的 Σ G * w
+        double sum_w[2] = {0.0, 0.0};                            // 两类分的 Σ w
+        int nonzero_A = 0, nonzero_B = 0;  // 窗口内 G 非零的分数，为 0 时把加权和清零，避免相减留下的舍入残差
+
+        bool empty() const { return count == 0; }
+
+        // 第 k 旧的一分（0 为窗口内最旧）
+        const Entry& at(int k) const {
+            return entries[(head - count + k + 2 * Window) % Window];
+        }
+
+        void push(double ga, double gb, int g_idx) {
+            for (int c = 0; c < 2; c++) {
+                sum_A[c] *= decay_table[c][1], sum_B[c] *= decay_table[c][1], sum_w[c] *= decay_table[c][1];
+            }
+            if (count == Window) {
+                // 最旧的一分此时距离为 Window，移出窗口
+                const Entry& old = entries[head];
+                nonzero_A -= old.G_A != 0, nonzero_B -= old.G_B != 0;
+                int c = Decay::pick(old.game_idx, ref_game);
+                sum_A[c] -= old.G_A * decay_table[c][Window];
+                sum_B[c] -= old.G_B * decay_table[c][Window];
+                sum_w[c] -= decay_table[c][Window];
+            }
+            int c = Decay::pick(g_idx, ref_game);
+            sum_A[c] += ga, sum_B[c] += gb, sum_w[c] += 1.0;
+            nonzero_A += ga != 0, nonzero_B += gb != 0;
+            if (nonzero_A == 0) sum_A[0] = sum_A[1] = 0.0;
+            if (nonzero_B == 0) sum_B[0] = sum_B[1] = 0.0;
+            entries[head] = {ga, gb, g_idx};
+            head = (head + 1) % Window;
+            if (count < Window) count++;
+        }
+
+        // 按新的本局重建加权和
+        void rebuild(int game_idx) {
+            ref_game = game_idx;
+            for (int c = 0; c < 2; c++) sum_A[c] = sum_B[c] = sum_w[c] = 0.0;
+            for (int k = 0; k < count; k++) {
+                const Entry& e = at(k);
+                int distance = count - 1 - k;
+                int c = Decay::pick(e.game_idx, game_idx);
+                sum_A[c] += e.G_A * decay_table[c][distance];
+                sum_B[c] += e.G_B * decay_table[c][distance];
+                sum_w[c] += decay_table[c][distance];
+            }
+        }
+
+        // 以 game_idx 为本局计算最近一分后的势能
+        void update_momentum(int game_idx) {
+            if (game_idx != ref_game) rebuild(game_idx);
+            double denominator = sum_w[0] + sum_w[1];
+            M_A = (denominator != 0) ? (sum_A[0] + sum_A[1]) / denominator : 0.0;
+            M_B = (denominator != 0) ? (sum_B[0] + sum_B[1]) / denominator : 0.0;
+        }
+
+        // 内容和加权和逐位相同（环形缓冲的起点可以不同）
+        bool identical(const MomentumWindow& o) const {
+            if (count != o.count || ref_game != o.ref_game) return false;
+            for (int k = 0; k < count; k++) {
+                const Entry &x = at(k), &y = o.at(k);
+                if (x.G_A != y.G_A || x.G_B != y.G_B || x.game_idx != y.game_idx) return false;
+            }
+            for (int c = 0; c < 2; c++)
+                if (sum_A[c] != o.sum_A[c] || sum_B[c] != o.sum_B[c] || sum_w[c] != o.sum_w[c]) return false;
+            return M_A == o.M_A && M_B == o.M_B && nonzero_A == o.nonzero_A && nonzero_B == o.nonzero_B;
+        }
+    };
+
+    // 模拟使用的历史：points[0, end) 中属于上一局和本局的最近 Window 分，末尾势能取 points[end - 1]。
+    // 只从 end 往前看 Window 个位置，不扫描整段历史
+    template <class Point>
+    static MomentumWindow windowAt(const std::vector<Point>& points, size_t end, int game_idx) {
+        MomentumWindow window;
+        window.ref_game = game_idx;
+        size_t begin = end - std::min(end, (size_t)Window);
+        for (size_t k = begin; k < end; k++) {
+            const Point& p = points[k];
+            if (p.game_idx < game_idx - 1 || p.game_idx > game_idx) continue;
+            window.push(p.G_A, p.G_B, p.game_idx);
+        }
+        if (!window.empty()) window.M_A = points[end - 1].M_A, window.M_B = points[end - 1].M_B;
+        return window;
+    }
+
+    // 从给定历史出发模拟打完本局，每一步 O(1) 更新势能。返回 {胜者, 模拟的分数}
+    template <class Player, class RNG>
+    static std::tuple<int, int> simulateGame(MomentumWindow window, const Player& a, const Player& b,
+                                             int scr1, int scr2, int game_idx, RNG& gen) {
+        int cur_scr1 = scr1, cur_scr2 = scr2, cnt = 0;
+        while (!isGameOver(cur_scr1, cur_scr2)) {
+            double current_M1 = std::abs(window.M_A);
+            double current_M2 = std::abs(window.M_B);
+            double current_delta_M1 = current_M2 - current_M1;
+            double current_delta_M2 = current_M1 - current_M2;
+            double current_elo1 = elo(a, current_M1, current_delta_M1);
+            double current_elo2 = elo(b, current_M2, current_delta_M2);
+            double dice = uniform01(gen) * (current_elo1 + current_elo2);
+            if (dice <= current_elo1) {
+                cur_scr1++;
+                window.push(current_elo1, 0.0, game_idx);
+            } else {
+                cur_scr2++;
+                window.push(0.0, -current_elo2, game_idx);
+            }
+            cnt++;
+            window.update_momentum(game_idx);
+        }
+        return {isGameOver(cur_scr1, cur_scr2), cnt};
+    }
+
+    // 蒙特卡洛本局胜率，返回 {A 胜率, B 胜率, 本局剩余分数的期望}
+    template <class Point, class Player, class RNG>
+    static std::tuple<double, double, double> winningRate(const std::vector<Point>& all_points, const Player& a,
+                                                          const Player& b, int scr1, int scr2, int game_idx,
+                                                          RNG& gen, int batch_size = 10000) {
+        MomentumWindow seed = windowAt(all_points, all_points.size(), game_idx);
+        int win1 = 0, win2 = 0;
+        double avg_cnt = 0;
+        for (int i = 0; i < batch_size; i++) {
+            auto [winner, cnt] = simulateGame(seed, a, b, scr1, scr2, game_idx, gen);
+            avg_cnt += cnt;
+            if (winner == 1) win1++;
+            else win2++;
+        }
+        return {1.0 * win1 / batch_size, 1.0 * win2 / batch_size, avg_cnt / batch_size};
+    }
+
+    // 这一分的杠杆；策略需要剩余分数时多模拟一次当前比分
+    template <class Point, class Player, class RNG>
+    static double calcLeverage(const std::vector<Point>& all_points, const Player& a, const Player& b,
+                               int scr1, int scr2, int game_idx, RNG& gen) {
+        double rtwp_win = std::get<0>(winningRate(all_points, a, b, scr1 + 1, scr2, game_idx, gen));
+        double rtwp_lose = std::get<0>(winningRate(all_points, a, b, scr1, scr2 + 1, game_idx, gen));
+        double cnt = 0;
+        if constexpr (Leverage::needs_count) cnt = std::get<2>(winningRate(all_points, a, b, scr1, scr2, game_idx, gen));
+        return leverage(rtwp_win, rtwp_lose, cnt);
+    }
+};
+
+// 各版本
+using Model03 = Model<EloClamp, DecayLegacy, LeverageDiff>;
+using Model04 = Model<EloSigmoid, DecaySameCross, LeverageWeighted<CountDecay04>>;
+using ModelPlot = Model<EloSigmoid, DecayLegacy, LeverageWeighted<CountDecayPlot>>;
+
+}  // namespace momentum
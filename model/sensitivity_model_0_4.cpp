@@ -0,0 +1,336 @@
+// model_0_4 参数敏感度：前向自动微分，一次重放同时得到逐分的 L_i、M_A、M_B 和它们对全部连续参数
+// （alpha、beta、w_cap、w_M、w_delta_M、双方的 cap/psy/sta）的偏导，以及数据集对数损失的梯度
+// 编译：g++ -O2 -std=c++17 -pthread sensitivity_model_0_4.cpp -o sensitivity_model_0_4
+// 运行：./sensitivity_model_0_4 [--input=逐分数据] [--threads=N] [--window=W] [--set=参数名=值 ...]
+//                              [--rollouts=N --seed=S] [--out=逐分结果]
+// 默认在 --exact 的截断历史动态规划上求导（导数对这一近似是精确的）；--rollouts=N 时改用固定种子的 N 次模拟，
+// 随机数流与 model_0_4 --seed=S 相同，胜率的导数用似然比估计：d E[Y] / dθ = E[(Y - mean(Y)) * d log P(路径) / dθ]。
+// 公式来自 calibrate_model_0_4 的运行期参数模型，标量换成对偶数即可。
+// 逐分结果为制表符分隔：match point game score L M_A M_B，随后依次是 L、M_A、M_B 对每个参数的偏导；
+// 对数损失及其梯度写到标准错误。
+#include <iomanip>
+
+#include "calibrate_model_0_4.hpp"
+
+/******************************dual numbers***********************************/
+
+// 前向模式对偶数：值 v 和对 N_PARAMS 个参数的偏导 d。比较只看值
+struct Dual {
+    double v = 0.0;
+    std::array<double, N_PARAMS> d{};
+
+    Dual() = default;
+    Dual(double x) : v(x) {}
+
+    // 第 i 个自变量
+    static Dual variable(double x, int i) {
+        Dual r(x);
+        r.d[i] = 1.0;
+        return r;
+    }
+
+    Dual operator-() const {
+        Dual r;
+        r.v = -v;
+        for (int i = 0; i < N_PARAMS; i++) r.d[i] = -d[i];
+        return r;
+    }
+    Dual& operator+=(const Dual& o) {
+        v += o.v;
+        for (int i = 0; i < N_PARAMS; i++) d[i] += o.d[i];
+        return *this;
+    }
+    Dual& operator-=(const Dual& o) {
+        v -= o.v;
+        for (int i = 0; i < N_PARAMS; i++) d[i] -= o.d[i];
+        return *this;
+    }
+    Dual& operator*=(const Dual& o) {
+        for (int i = 0; i < N_PARAMS; i++) d[i] = d[i] * o.v + v * o.d[i];
+        v *= o.v;
+        return *this;
+    }
+    Dual& operator/=(const Dual& o) {
+        v /= o.v;
+        for (int i = 0; i < N_PARAMS; i++) d[i] = (d[i] - v * o.d[i]) / o.v;
+        return *this;
+    }
+
+    friend Dual operator+(Dual a, const Dual& b) { return a += b; }
+    friend Dual operator-(Dual a, const Dual& b) { return a -= b; }
+    friend Dual operator*(Dual a, const Dual& b) { return a *= b; }
+    friend Dual operator/(Dual a, const Dual& b) { return a /= b; }
+    friend bool operator<(const Dual& a, const Dual& b) { return a.v < b.v; }
+    friend bool operator>(const Dual& a, const Dual& b) { return a.v > b.v; }
+    friend bool operator<=(const Dual& a, const Dual& b) { return a.v <= b.v; }
+    friend bool operator>=(const Dual& a, const Dual& b) { return a.v >= b.v; }
+    friend bool operator==(const Dual& a, const Dual& b) { return a.v == b.v; }
+    friend bool operator!=(const Dual& a, const Dual& b) { return a.v != b.v; }
+};
+
+Dual exp(const Dual& x) {
+    Dual r(std::exp(x.v));
+    for (int i = 0; i < N_PARAMS; i++) r.d[i] = r.v * x.d[i];
+    return r;
+}
+
+Dual log(const Dual& x) {
+    Dual r(std::log(x.v));
+    for (int i = 0; i < N_PARAMS; i++) r.d[i] = x.d[i] / x.v;
+    return r;
+}
+
+Dual abs(const Dual& x) { return x.v < 0 ? -x : x; }
+
+// 平分值迭代的收敛判据：值和各偏导（按量级取相对差）都不再变化
+double iterationDistance(const Dual& a, const Dual& b) {
+    double diff = std::abs(a.v - b.v);
+    for (int i = 0; i < N_PARAMS; i++) diff = std::max(diff, std::abs(a.d[i] - b.d[i]) / (1.0 + std::abs(a.d[i])));
+    return diff;
+}
+
+using DualModel = BasicTunedModel<Dual>;
+using DualWindow = BasicTunedWindow<Dual>;
+using DualSolver = BasicTunedSolver<Dual>;
+
+/******************************dual numbers***********************************/
+
+/******************************win rates**************************************/
+
+// 胜率来源：给定模拟历史和起始比分，返回 {A 赢下本局的概率, 本局剩余分数的期望}，都带偏导。
+// 每分先 begin 一次（历史在这一分内不变），再对 当前 / 赢下 / 输掉 三个比分求值
+
+// --exact 的截断历史动态规划
+struct ExactRates {
+    DualSolver solver;
+
+    void begin(const DualModel& m, const DualWindow& seed, int game_idx, uint32_t) { solver.reset(m, seed, game_idx); }
+    std::pair<Dual, Dual> operator()(int a, int b) {
+        DualSolver::Value v = solver.solve(a, b, 0, 0);
+        return {v.p1, v.cnt};
+    }
+};
+
+// 固定种子的模拟：第 i 次模拟用 model_0_4 同一条流 (种子, 比赛, 分序号, i)，骰子只看值，
+// 所以值部分就是 model_0_4 --seed 的蒙特卡洛结果。Y 和剩余分数是路径的阶梯函数，导数全部来自路径概率：
+// 每分 A 得分概率 q 的对数导数 d q / q（A 得分）或 -d q / (1 - q)（B 得分）累加为路径的得分函数，
+// 以样本均值为基线乘上 Y（剩余分数）再平均
+struct RolloutRates {
+    int rollouts;
+    uint32_t match;
+    const DualModel* model = nullptr;
+    const DualWindow* seed = nullptr;
+    int game_idx = 0;
+    uint32_t point = 0;
+
+    void begin(const DualModel& m, const DualWindow& s, int g_idx, uint32_t point_key) {
+        model = &m, seed = &s, game_idx = g_idx, point = point_key;
+    }
+
+    std::pair<Dual, Dual> operator()(int a, int b) const {
+        using Grad = std::array<double, N_PARAMS>;
+        double sum_y = 0, sum_cnt = 0;
+        Grad sum_s{}, sum_ys{}, sum_cs{};
+        for (int i = 0; i < rollouts; i++) {
+            PhiloxStream rng(rng_seed, match, point, i);
+            DualWindow window = *seed;
+            int cur_scr1 = a, cur_scr2 = b, cnt = 0;
+            Grad score{};
+            while (!isGameOver(cur_scr1, cur_scr2)) {
+                Dual M1 = abs(window.M_A), M2 = abs(window.M_B);
+                Dual elo1 = model->eloA(M1, M2 - M1);
+                Dual elo2 = model->eloB(M2, M1 - M2);
+                std::uniform_real_distribution<double> distribution(0.0, elo1.v + elo2.v);
+                double dice = distribution(rng);
+                Dual q = elo1 / (elo1 + elo2);
+                if (dice <= elo1.v) {
+                    cur_scr1++;
+                    for (int k = 0; k < N_PARAMS; k++) score[k] += q.d[k] / q.v;
+                    window.push(*model, elo1, 0.0, game_idx);
+                } else {
+                    cur_scr2++;
+                    for (int k = 0; k < N_PARAMS; k++) score[k] -= q.d[k] / (1 - q.v);
+                    window.push(*model, 0.0, -elo2, game_idx);
+                }
+                cnt++;
+                window.update_momentum(*model, game_idx);
+            }
+            double y = isGameOver(cur_scr1, cur_scr2) == 1;
+            sum_y += y, sum_cnt += cnt;
+            for (int k = 0; k < N_PARAMS; k++) {
+                sum_s[k] += score[k], sum_ys[k] += y * score[k], sum_cs[k] += cnt * score[k];
+            }
+        }
+        rollout_count += rollouts;
+        Dual p(sum_y / rollouts), cnt(sum_cnt / rollouts);
+        for (int k = 0; k < N_PARAMS; k++) {
+            p.d[k] = (sum_ys[k] - p.v * sum_s[k]) / rollouts;
+            cnt.d[k] = (sum_cs[k] - cnt.v * sum_s[k]) / rollouts;
+        }
+        return {p, cnt};
+    }
+};
+
+/******************************win rates**************************************/
+
+/******************************replay*****************************************/
+
+struct PointSensitivity {
+    int game, scrA, scrB;  // 这一分后的比分
+    Dual L, M_A, M_B;
+};
+
+struct DualLoss {
+    Dual points_nll, games_nll;
+    long long points = 0, games = 0;
+
+    void add(const DualLoss& o) {
+        points_nll += o.points_nll, games_nll += o.games_nll;
+        points += o.points, games += o.games;
+    }
+};
+
+Dual nll(const Dual& p, bool happened) {
+    if (p.v < 1e-12 || p.v > 1.0 - 1e-12) return nll(p.v, happened);
+    return -log(happened ? p : 1.0 - p);
+}
+
+// 与 evaluateMatch 相同的重放，另外记下每一分的 L、M_A、M_B
+template <class Rates>
+DualLoss replayMatch(const DualModel& m, const MatchRecord& match, Rates& rates, std::vector<PointSensitivity>& out) {
+    DualLoss loss;
+    DualWindow history;
+    uint32_t point_key = 0;  // 与 MatchContext::pointKey 相同：此前已分析的分数
+    for (int game_idx = 0; game_idx < match.games(); ++game_idx) {
+        std::string_view seq = match.game(game_idx);
+        if (seq.empty()) continue;
+        int scrA = 0, scrB = 0;
+        for (char winner : seq) scrA += winner == playerA.id;
+        bool game_won = scrA * 2 > (int)seq.size();
+        scrA = 0;
+
+        for (char winner : seq) {
+            DualWindow seed;
+            for (int k = 0; k < history.count; k++)
+                if (history.game[k] >= game_idx - 1) seed.push(m, history.G_A[k], history.G_B[k], history.game[k]);
+            if (seed.count) seed.M_A = history.M_A, seed.M_B = history.M_B;
+
+            rates.begin(m, seed, game_idx, point_key);
+            Dual rtwp_win = rates(scrA + 1, scrB).first;
+            Dual rtwp_lose = rates(scrA, scrB + 1).first;
+            auto [p_now, cnt] = rates(scrA, scrB);
+            if (scrA == 0 && scrB == 0) {
+                loss.games_nll += nll(p_now, game_won);
+                loss.games++;
+            }
+            bool won = winner == playerA.id;
+            loss.points_nll += nll(seed.pointProb(m), won);
+            loss.points++;
+
+            // Core::leverage 的对偶数版本：min((win - lose) * (0.7 * e^(-0.2 * (cnt - 1)) + 0.3), 0.2)
+            using W = Core::Leverage;
+            using P = momentum::CountDecay04;
+            static_assert(std::is_same_v<W, momentum::LeverageWeighted<P>>, "对偶数杠杆按 CountDecay04 展开");
+            Dual L = (rtwp_win - rtwp_lose) * (P::scale * exp(-P::rate * (cnt - 1.0)) + P::floor);
+            if (L > P::cap) L = P::cap;
+            history.push(m, won ? L : Dual(0.0), won ? Dual(0.0) : -L, game_idx);
+            history.update_momentum(m, game_idx);
+            if (won) scrA++;
+            else scrB++;
+            point_key++;
+            out.push_back({game_idx + 1, scrA, scrB, L, history.M_A, history.M_B});
+        }
+    }
+    return loss;
+}
+
+/******************************replay*****************************************/
+
+void printHeader(std::ostream& out) {
+    out << "match\tpoint\tgame\tscore\tL\tM_A\tM_B";
+    for (const char* q : {"L", "M_A", "M_B"})
+        for (int i = 0; i < N_PARAMS; i++) out << "\td" << q << "/d" << PARAM_SPECS[i].name;
+    out << "\n";
+}
+
+void printPoints(std::ostream& out, const MatchRecord& match, const std::vector<PointSensitivity>& points) {
+    for (size_t k = 0; k < points.size(); k++) {
+        const PointSensitivity& p = points[k];
+        out << match.id << "\t" << k + 1 << "\t" << p.game << "\t" << p.scrA << ":" << p.scrB << "\t" << p.L.v << "\t"
+            << p.M_A.v << "\t" << p.M_B.v;
+        for (const Dual* q : {&p.L, &p.M_A, &p.M_B})
+            for (int i = 0; i < N_PARAMS; i++) out << "\t" << q->d[i];
+        out << "\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    parseArgs(argc, argv);
+    Params params = modelParams();
+    int rollouts = 0;
+    std::string out_path;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--rollouts=", 0) == 0) rollouts = std::max(0, std::stoi(arg.substr(11)));
+        else if (arg.rfind("--window=", 0) == 0) params.window = std::min(MAX_WINDOW, std::max(1, std::stoi(arg.substr(9))));
+        else if (arg.rfind("--out=", 0) == 0) out_path = arg.substr(6);
+        else if (arg.rfind("--set=", 0) == 0) {
+            std::string assign = arg.substr(6);
+            size_t eq = assign.find('=');
+            std::string name = assign.substr(0, eq);
+            int idx = -1;
+            for (int p = 0; p < N_PARAMS; p++) if (name == PARAM_SPECS[p].name) idx = p;
+            if (idx < 0 || eq == std::string::npos) {
+                std::cerr << "unknown parameter in " << arg << "\n";
+                return 1;
+            }
+            params.x[idx] = std::stod(assign.substr(eq + 1));
+        }
+    }
+
+    std::vector<MatchRecord> matches;
+    if (!loadMatches(matches)) return 1;
+
+    std::array<Dual, N_PARAMS> x;
+    for (int i = 0; i < N_PARAMS; i++) x[i] = Dual::variable(params.x[i], i);
+    DualModel model(x, params.window);
+
+    // 比赛之间互不依赖，按比赛并行
+    auto t0 = std::chrono::steady_clock::now();
+    int n = matches.size();
+    std::vector<std::vector<PointSensitivity>> points(n);
+    std::vector<DualLoss> losses(n);
+    std::function<void(int)> task = [&](int k) {
+        if (rollouts > 0) {
+            RolloutRates rates{rollouts, (uint32_t)k};
+            losses[k] = replayMatch(model, matches[k], rates, points[k]);
+        } else {
+            thread_local ExactRates rates;
+            losses[k] = replayMatch(model, matches[k], rates, points[k]);
+        }
+    };
+    if (pool) pool->parallel_for(n, task);
+    else for (int k = 0; k < n; k++) task(k);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::ofstream file;
+    if (!out_path.empty()) file.open(out_path);
+    std::ostream& out = out_path.empty() ? std::cout : file;
+    out << std::setprecision(6);
+    printHeader(out);
+    for (int k = 0; k < n; k++) printPoints(out, matches[k], points[k]);
+
+    DualLoss total;
+    for (const DualLoss& l : losses) total.add(l);
+    Dual loss = total.points_nll + total.games_nll;
+    std::cerr << std::setprecision(6) << (rollouts > 0 ? "rollouts: " + std::to_string(rollouts) : "exact")
+              << ", window " << params.window << ", " << n << " matches in " << seconds << "s\n";
+    std::cerr << "loss " << loss.v << " (points " << total.points_nll.v << " over " << total.points << ", games "
+              << total.games_nll.v << " over " << total.games << ")\n";
+    std::cerr << "parameter\tvalue\t\td loss\n";
+    for (int i = 0; i < N_PARAMS; i++) {
+        std::string name = PARAM_SPECS[i].name;
+        std::cerr << name << (name.size() < 8 ? "\t\t" : "\t") << params.x[i] << "\t\t" << loss.d[i] << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+import sys
+import numpy as np
+
+# --------------------------
+# 读取 model_0_4 --out-bin= 生成的二进制列式结果（格式见 model_0_4_io.hpp 中 ResultWriter 的注释）
+# 各列直接 memmap，不做解析
+# --------------------------
+HEADER = np.dtype([
+    ("magic", "S8"), ("version", "<u4"), ("n_columns", "<u4"),
+    ("n_matches", "<u8"), ("n_points", "<u8"),
+    ("columns_offset", "<u8"), ("matches_offset", "<u8"),
+    ("strings_offset", "<u8"), ("strings_size", "<u8"),
+])
+COLUMN = np.dtype([("name", "S16"), ("dtype", "S8"), ("offset", "<u8")])
+MATCH = np.dtype([
+    ("first_point", "<i8"), ("n_points", "<i8"),
+    ("str_offset", "<i8"), ("str_len", "<i4"), ("n_games", "<i4"),
+])
+
+
+def load_results(path):
+    """返回 (matches, columns)：matches 为每场比赛的信息列表，columns 为 列名 -> numpy.memmap"""
+    header = np.fromfile(path, dtype=HEADER, count=1)[0]
+    if header["magic"] != b"MOMRSLT" or header["version"] != 1:
+        raise ValueError(f"{path}: 不是版本 1 的结果文件")
+    n = int(header["n_points"])
+    directory = np.memmap(path, dtype=COLUMN, mode="r",
+                          offset=int(header["columns_offset"]), shape=(int(header["n_columns"]),))
+    columns = {}
+    for col in directory:
+        columns[col["name"].decode()] = np.memmap(path, dtype=col["dtype"].decode(), mode="r",
+                                                  offset=int(col["offset"]), shape=(n,))
+
+    table = np.memmap(path, dtype=MATCH, mode="r",
+                      offset=int(header["matches_offset"]), shape=(int(header["n_matches"]),))
+    strings = np.memmap(path, dtype=np.uint8, mode="r",
+                        offset=int(header["strings_offset"]), shape=(int(header["strings_size"]),)).tobytes()
+    matches = []
+    for m in table:
+        begin = int(m["str_offset"])
+        match_id, player1, player2 = strings[begin:begin + int(m["str_len"])].decode().split("\t")
+        matches.append({
+            "id": match_id, "player1": player1, "player2": player2,
+            "first_point": int(m["first_point"]), "n_points": int(m["n_points"]), "n_games": int(m["n_games"]),
+        })
+    return matches, columns
+
+
+if __name__ == "__main__":
+    matches, columns = load_results(sys.argv[1])
+    print(f"{len(matches)} 场比赛，{len(columns['point'])} 分")
+    for m in matches:
+        last = m["first_point"] + m["n_points"] - 1
+        print(f"{m['id']}\t{m['n_games']} 局\t{m['n_points']} 分\t"
+              f"M_A={columns['M_A'][last]:.6f}\tM_B={columns['M_B'][last]:.6f}")